@@ -12,10 +12,13 @@ int
 main(int argc, char** argv)
 {
     ECC_Start();
+    ECCVerifyHandle globalVerifyHandle;
     SetupEnvironment();
     fPrintToDebugLog = false; // don't want to write to debug.log file
+    ParseParameters(argc, argv);
 
-    benchmark::BenchRunner::RunAll();
+    // -filter=<regex> restricts the run to matching benchmark names, e.g. -filter=POW_.*
+    benchmark::BenchRunner::RunAll(1.0, GetArg("-filter", ".*"));
 
     ECC_Stop();
 }
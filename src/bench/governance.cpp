@@ -0,0 +1,97 @@
+// Copyright (c) 2019 The Kepler developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "cachemap.h"
+#include "random.h"
+#include "uint256.h"
+
+#include <vector>
+
+/*
+ * Removal of the vote references of a deleted governance object, as done by
+ * CGovernanceManager::UpdateCachesAndClean. The vote cache holds 500 proposals
+ * with 5k votes each, bounded like cmapVoteToObject so only the newest 1M votes
+ * stay in it. Each pass deletes one object and puts its votes back, so the
+ * cache stays at the same size.
+ */
+static const int OBJECT_COUNT = 500;
+static const int VOTES_PER_OBJECT = 5000;
+static const int VOTE_CACHE_SIZE = 1000000;
+
+struct GovernanceObject {
+    std::vector<uint256> vVoteHashes;
+};
+
+static std::vector<GovernanceObject>& GovernanceObjects()
+{
+    static std::vector<GovernanceObject> vObjects(OBJECT_COUNT);
+    if (vObjects[0].vVoteHashes.empty()) {
+        for (int i = 0; i < VOTES_PER_OBJECT; i++) {
+            for (auto& obj : vObjects) {
+                obj.vVoteHashes.push_back(GetRandHash());
+            }
+        }
+    }
+    return vObjects;
+}
+
+template<typename CacheMapType>
+static void FillVoteCache(CacheMapType& cmapVoteToObject, std::vector<GovernanceObject>& vObjects)
+{
+    for (int i = 0; i < VOTES_PER_OBJECT; i++) {
+        for (auto& obj : vObjects) {
+            cmapVoteToObject.Insert(obj.vVoteHashes[i], &obj);
+        }
+    }
+}
+
+template<typename CacheMapType>
+static void AddVotes(CacheMapType& cmapVoteToObject, GovernanceObject& obj)
+{
+    for (const auto& hash : obj.vVoteHashes) {
+        cmapVoteToObject.Insert(hash, &obj);
+    }
+}
+
+// Walk the whole cache for the deleted object
+static void GOV_CleanupScan(benchmark::State& state)
+{
+    std::vector<GovernanceObject>& vObjects = GovernanceObjects();
+    CacheMap<uint256, GovernanceObject*> cmapVoteToObject(VOTE_CACHE_SIZE);
+    FillVoteCache(cmapVoteToObject, vObjects);
+    size_t nPass = 0;
+    while (state.KeepRunning()) {
+        GovernanceObject* pObj = &vObjects[nPass++ % vObjects.size()];
+        const CacheMap<uint256, GovernanceObject*>::list_t& listItems = cmapVoteToObject.GetItemList();
+        CacheMap<uint256, GovernanceObject*>::list_cit lit = listItems.begin();
+        while (lit != listItems.end()) {
+            if (lit->value == pObj) {
+                uint256 nKey = lit->key;
+                ++lit;
+                cmapVoteToObject.Erase(nKey);
+            } else {
+                ++lit;
+            }
+        }
+        AddVotes(cmapVoteToObject, *pObj);
+    }
+}
+
+// Erase through the per-object index
+static void GOV_CleanupIndexed(benchmark::State& state)
+{
+    std::vector<GovernanceObject>& vObjects = GovernanceObjects();
+    ValueIndexedCacheMap<uint256, GovernanceObject*> cmapVoteToObject(VOTE_CACHE_SIZE);
+    FillVoteCache(cmapVoteToObject, vObjects);
+    size_t nPass = 0;
+    while (state.KeepRunning()) {
+        GovernanceObject* pObj = &vObjects[nPass++ % vObjects.size()];
+        cmapVoteToObject.EraseValue(pObj);
+        AddVotes(cmapVoteToObject, *pObj);
+    }
+}
+
+BENCHMARK(GOV_CleanupScan);
+BENCHMARK(GOV_CleanupIndexed);
@@ -0,0 +1,92 @@
+// Copyright (c) 2019 The Kepler developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "instantx.h"
+#include "random.h"
+#include "uint256.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+/*
+ * The orphan vote part of CInstantSend::SyncTransaction for every tx of a
+ * connected block: a 2000-tx block against 50k orphan votes, spread over
+ * 10k unknown txs with 5 votes each. One tx in ten of the block has orphan
+ * votes. The old code scanned every orphan vote for every tx of the block,
+ * the tx hash index only looks at the votes for the tx itself.
+ */
+static const int BLOCK_TX_COUNT = 2000;
+static const int ORPHAN_TX_COUNT = 10000;
+static const int VOTES_PER_ORPHAN_TX = 5;
+
+struct OrphanVotes {
+    std::vector<uint256> vBlockTxHashes;
+    std::map<uint256, CTxLockVote> mapTxLockVotes;
+    std::map<uint256, CTxLockVote> mapTxLockVotesOrphan;
+    std::map<uint256, std::set<uint256> > mapTxLockVotesOrphanByTx;
+
+    OrphanVotes()
+    {
+        for (int i = 0; i < ORPHAN_TX_COUNT; i++) {
+            uint256 txHash = GetRandHash();
+            for (int j = 0; j < VOTES_PER_ORPHAN_TX; j++) {
+                CTxLockVote vote(txHash, COutPoint(GetRandHash(), 0), COutPoint(GetRandHash(), 0));
+                uint256 nVoteHash = vote.GetHash();
+                mapTxLockVotes.emplace(nVoteHash, vote);
+                mapTxLockVotesOrphan.emplace(nVoteHash, vote);
+                mapTxLockVotesOrphanByTx[txHash].insert(nVoteHash);
+            }
+            if (i % 10 == 0 && (int)vBlockTxHashes.size() < BLOCK_TX_COUNT / 10) {
+                vBlockTxHashes.push_back(txHash);
+            }
+        }
+        while ((int)vBlockTxHashes.size() < BLOCK_TX_COUNT) {
+            vBlockTxHashes.push_back(GetRandHash());
+        }
+    }
+};
+
+static OrphanVotes& GetOrphanVotes()
+{
+    static OrphanVotes orphanVotes;
+    return orphanVotes;
+}
+
+static void IS_SyncBlockOrphanScan(benchmark::State& state)
+{
+    OrphanVotes& orphanVotes = GetOrphanVotes();
+    int nHeight = 0;
+    while (state.KeepRunning()) {
+        nHeight++;
+        for (const auto& txHash : orphanVotes.vBlockTxHashes) {
+            for (const auto& pair : orphanVotes.mapTxLockVotesOrphan) {
+                if (pair.second.GetTxHash() == txHash) {
+                    orphanVotes.mapTxLockVotes[pair.first].SetConfirmedHeight(nHeight);
+                }
+            }
+        }
+    }
+}
+
+static void IS_SyncBlockOrphanIndex(benchmark::State& state)
+{
+    OrphanVotes& orphanVotes = GetOrphanVotes();
+    int nHeight = 0;
+    while (state.KeepRunning()) {
+        nHeight++;
+        for (const auto& txHash : orphanVotes.vBlockTxHashes) {
+            auto itByTx = orphanVotes.mapTxLockVotesOrphanByTx.find(txHash);
+            if (itByTx == orphanVotes.mapTxLockVotesOrphanByTx.end())
+                continue;
+            for (const auto& nVoteHash : itByTx->second) {
+                orphanVotes.mapTxLockVotes[nVoteHash].SetConfirmedHeight(nHeight);
+            }
+        }
+    }
+}
+
+BENCHMARK(IS_SyncBlockOrphanScan);
+BENCHMARK(IS_SyncBlockOrphanIndex);
@@ -0,0 +1,104 @@
+// Copyright (c) 2019 The Kepler developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "key.h"
+#include "masternodeman.h"
+#include "random.h"
+#include "script/standard.h"
+
+#include <vector>
+
+/*
+ * Masternode list lookups done while validating payment votes: the voter by
+ * outpoint, then the voted payee by its script. 10k votes against a list of
+ * 5k masternodes. Signature checks are left out, they cost the same either way.
+ */
+static const int LIST_SIZE = 5000;
+static const int VOTE_COUNT = 10000;
+
+struct PaymentVote {
+    COutPoint masternodeOutpoint;
+    CScript payee;
+};
+
+static CMasternodeMan& MasternodeList(std::vector<PaymentVote>& vVotesRet)
+{
+    static CMasternodeMan mnman;
+    static std::vector<PaymentVote> vVotes;
+    if (vVotes.empty()) {
+        std::vector<CMasternode> vMasternodes;
+        for (int i = 0; i < LIST_SIZE; i++) {
+            CKey keyCollateral;
+            CKey keyMasternode;
+            keyCollateral.MakeNewKey(true);
+            keyMasternode.MakeNewKey(true);
+            vMasternodes.push_back(CMasternode(CService(), COutPoint(GetRandHash(), 0),
+                                               keyCollateral.GetPubKey(), keyMasternode.GetPubKey(), PROTOCOL_VERSION));
+            mnman.Add(vMasternodes.back());
+        }
+        FastRandomContext rng(true);
+        for (int i = 0; i < VOTE_COUNT; i++) {
+            const CMasternode& voter = vMasternodes[rng.rand32(LIST_SIZE)];
+            const CMasternode& payee = vMasternodes[rng.rand32(LIST_SIZE)];
+            vVotes.push_back(PaymentVote{voter.outpoint, GetScriptForDestination(payee.pubKeyCollateralAddress.GetID())});
+        }
+    }
+    vVotesRet = vVotes;
+    return mnman;
+}
+
+static void MN_PaymentVoteLookup(benchmark::State& state)
+{
+    std::vector<PaymentVote> vVotes;
+    CMasternodeMan& mnman = MasternodeList(vVotes);
+    masternode_info_t infoVoter;
+    masternode_info_t infoPayee;
+    while (state.KeepRunning()) {
+        for (const auto& vote : vVotes) {
+            assert(mnman.GetMasternodeInfo(vote.masternodeOutpoint, infoVoter));
+            assert(mnman.GetMasternodeInfo(vote.payee, infoPayee));
+        }
+    }
+}
+
+static void MN_PaymentVoteLookupByPubKey(benchmark::State& state)
+{
+    std::vector<PaymentVote> vVotes;
+    CMasternodeMan& mnman = MasternodeList(vVotes);
+    std::vector<CPubKey> vPubKeys;
+    for (const auto& vote : vVotes) {
+        masternode_info_t info;
+        assert(mnman.GetMasternodeInfo(vote.masternodeOutpoint, info));
+        vPubKeys.push_back(info.pubKeyMasternode);
+    }
+    masternode_info_t info;
+    while (state.KeepRunning()) {
+        for (const auto& pubKey : vPubKeys)
+            assert(mnman.GetMasternodeInfo(pubKey, info));
+    }
+}
+
+// The payee lookup as a scan of the list, as done before the key indexes
+static void MN_PaymentVoteLookupScan(benchmark::State& state)
+{
+    std::vector<PaymentVote> vVotes;
+    std::map<COutPoint, CMasternode> mapMasternodes = MasternodeList(vVotes).GetFullMasternodeMap();
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < vVotes.size(); i += 100) {
+            bool fFound = false;
+            for (const auto& mnpair : mapMasternodes) {
+                if (GetScriptForDestination(mnpair.second.pubKeyCollateralAddress.GetID()) == vVotes[i].payee) {
+                    fFound = true;
+                    break;
+                }
+            }
+            assert(fFound);
+        }
+    }
+}
+
+BENCHMARK(MN_PaymentVoteLookup);
+BENCHMARK(MN_PaymentVoteLookupByPubKey);
+BENCHMARK(MN_PaymentVoteLookupScan);
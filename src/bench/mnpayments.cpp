@@ -0,0 +1,88 @@
+// Copyright (c) 2019 The Kepler developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "activemasternode.h"
+#include "key.h"
+#include "masternode-payments.h"
+#include "random.h"
+#include "script/standard.h"
+#include "util.h"
+#include "validation.h"
+
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+/*
+ * Signature checks of a burst of payment votes, like the one a node gets
+ * while syncing the winners list: 1000 votes from 100 masternodes, checked
+ * one by one on the calling thread, and in batches on the vote check threads.
+ */
+static const int MASTERNODE_COUNT = 100;
+static const int VOTE_COUNT = 1000;
+static const int MIN_CORES = 2;
+
+static const std::vector<CPendingPaymentVote>& SignedVotes()
+{
+    static std::vector<CPendingPaymentVote> vVotes;
+    if (vVotes.empty()) {
+        std::vector<CKey> vKeys(MASTERNODE_COUNT);
+        std::vector<COutPoint> vOutpoints;
+        for (auto& key : vKeys) {
+            key.MakeNewKey(true);
+            vOutpoints.push_back(COutPoint(GetRandHash(), 0));
+        }
+        for (int i = 0; i < VOTE_COUNT; i++) {
+            int nVoter = i % MASTERNODE_COUNT;
+            CKey keyPayee;
+            keyPayee.MakeNewKey(true);
+            CMasternodePaymentVote vote(vOutpoints[nVoter], 100000 + i / 10, GetScriptForDestination(keyPayee.GetPubKey().GetID()));
+            activeMasternode.keyMasternode = vKeys[nVoter];
+            activeMasternode.pubKeyMasternode = vKeys[nVoter].GetPubKey();
+            assert(vote.Sign());
+            vVotes.push_back(CPendingPaymentVote(vote, -1, vKeys[nVoter].GetPubKey(), 100000));
+        }
+        activeMasternode.keyMasternode = CKey();
+        activeMasternode.pubKeyMasternode = CPubKey();
+    }
+    return vVotes;
+}
+
+static void MNW_VerifySerial(benchmark::State& state)
+{
+    const std::vector<CPendingPaymentVote>& vVotes = SignedVotes();
+    while (state.KeepRunning()) {
+        for (const auto& pendingVote : vVotes) {
+            int nDos = 0;
+            assert(pendingVote.vote.CheckSignature(pendingVote.pubKeyMasternode, pendingVote.nValidationHeight, nDos));
+        }
+    }
+}
+
+static void MNW_VerifyBatch(benchmark::State& state)
+{
+    const std::vector<CPendingPaymentVote>& vVotes = SignedVotes();
+    int nCheckThreadsPrev = nScriptCheckThreads;
+    nScriptCheckThreads = std::max(MIN_CORES, GetNumCores());
+    boost::thread_group tg;
+    for (int i = 0; i < nScriptCheckThreads - 1; i++) {
+        tg.create_thread(&ThreadPaymentVoteCheck);
+    }
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < vVotes.size(); i += MNPAYMENTS_VOTE_CHECK_BATCH_SIZE) {
+            std::vector<CPendingPaymentVote> vBatch(vVotes.begin() + i, vVotes.begin() + std::min(vVotes.size(), i + MNPAYMENTS_VOTE_CHECK_BATCH_SIZE));
+            CheckPaymentVoteSignatures(vBatch);
+            for (const auto& pendingVote : vBatch) {
+                assert(pendingVote.fValid);
+            }
+        }
+    }
+    tg.interrupt_all();
+    tg.join_all();
+    nScriptCheckThreads = nCheckThreadsPrev;
+}
+
+BENCHMARK(MNW_VerifySerial);
+BENCHMARK(MNW_VerifyBatch);
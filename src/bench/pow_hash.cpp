@@ -0,0 +1,203 @@
+// Copyright (c) 2019 The Kepler developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "checkqueue.h"
+#include "pow.h"
+#include "random.h"
+#include "uint256.h"
+#include "util.h"
+#include "crypto/hashargon2d.h"
+#include "crypto/powscratch.h"
+#include "primitives/block.h"
+
+#include <vector>
+#include <boost/thread/thread.hpp>
+
+/* Size of a block header, the input of every PoW hash */
+static const size_t HEADER_SIZE = 80;
+
+/*
+ * Memory touched by a single hash of each algorithm:
+ *   ALGO_SLOT1 NeoScrypt      ~32KB, on the stack
+ *   ALGO_SLOT2 Argon2d-4096   4MB, per-thread scratch arena
+ *   ALGO_SLOT3 Lyra2CZ        96KB (4 rows of 256 columns), allocated per hash
+ * The _Cold variant releases the arena before every hash so it times the
+ * first-touch cost of that footprint, which is what a freshly started
+ * worker thread pays.
+ */
+
+static CBlockHeader MakeHeader(int algo)
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.SetAlgo(algo);
+    header.nTime = 1546300800;
+    header.nBits = 0x1e0fffff;
+    return header;
+}
+
+// Single-hash latency through CBlockHeader::GetPoWHash, as called during validation
+static void PoWHashLatency(benchmark::State& state, int algo)
+{
+    CBlockHeader header = MakeHeader(algo);
+    uint256 hash;
+    while (state.KeepRunning()) {
+        header.nNonce++;
+        hash = header.GetPoWHash(algo);
+    }
+}
+
+static void PoWHashCold(benchmark::State& state, int algo)
+{
+    CBlockHeader header = MakeHeader(algo);
+    uint256 hash;
+    while (state.KeepRunning()) {
+        PoWScratch().Release();
+        header.nNonce++;
+        hash = header.GetPoWHash(algo);
+    }
+}
+
+// Multi-threaded throughput: hash batches of headers on a CCheckQueue, the
+// same machinery that verifies header PoW during sync
+static const int MIN_CORES = 2;
+static const size_t POW_BATCH_SIZE = 64;
+
+struct PoWHashJob {
+    CBlockHeader header;
+    uint256 hash;
+    bool operator()()
+    {
+        hash = header.GetPoWHash(header.GetAlgo());
+        return true;
+    }
+    void swap(PoWHashJob& x)
+    {
+        std::swap(header, x.header);
+        std::swap(hash, x.hash);
+    }
+};
+
+static void PoWHashThroughput(benchmark::State& state, int algo)
+{
+    CCheckQueue<PoWHashJob> queue {8};
+    boost::thread_group tg;
+    for (auto x = 0; x < std::max(MIN_CORES, GetNumCores()) - 1; ++x) {
+       tg.create_thread([&]{queue.Thread();});
+    }
+    uint32_t nNonce = 0;
+    while (state.KeepRunning()) {
+        CCheckQueueControl<PoWHashJob> control(&queue);
+        std::vector<PoWHashJob> vChecks(POW_BATCH_SIZE);
+        for (auto& job : vChecks) {
+            job.header = MakeHeader(algo);
+            job.header.nNonce = nNonce++;
+        }
+        control.Add(vChecks);
+        control.Wait();
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+static void POW_NeoScrypt(benchmark::State& state) { PoWHashLatency(state, ALGO_SLOT1); }
+static void POW_Argon2d(benchmark::State& state) { PoWHashLatency(state, ALGO_SLOT2); }
+static void POW_Lyra2CZ(benchmark::State& state) { PoWHashLatency(state, ALGO_SLOT3); }
+static void POW_Argon2d_Cold(benchmark::State& state) { PoWHashCold(state, ALGO_SLOT2); }
+static void POW_NeoScrypt_Threads(benchmark::State& state) { PoWHashThroughput(state, ALGO_SLOT1); }
+static void POW_Argon2d_Threads(benchmark::State& state) { PoWHashThroughput(state, ALGO_SLOT2); }
+static void POW_Lyra2CZ_Threads(benchmark::State& state) { PoWHashThroughput(state, ALGO_SLOT3); }
+
+// Argon2d-4096 as called before the scratch arena: 4MB matrix allocated per hash
+static void POW_Argon2d_Alloc(benchmark::State& state)
+{
+    uint256 hash;
+    std::vector<uint8_t> in(HEADER_SIZE, 0);
+    while (state.KeepRunning())
+        argon2d_hash_raw(1, 4096, 1, in.data(), in.size(), in.data(), in.size(), hash.begin(), 32);
+}
+
+static void POW_Argon2d_Scratch(benchmark::State& state)
+{
+    uint256 hash;
+    std::vector<uint8_t> in(HEADER_SIZE, 0);
+    while (state.KeepRunning())
+        hash = HashArgon2d(in.begin(), in.end());
+}
+
+// Difficulty retargeting on a synthetic multi-algo chain. The algos are mixed
+// 50/35/15 so the walk back to the last block of the rarest algo is as long as
+// it gets on a lopsided mainnet. Each benchmark builds the chain (a few hundred
+// MB) itself, so it's freed again before the next one runs.
+static const int SYNTHETIC_CHAIN_HEIGHT = 1000000;
+static const size_t RETARGET_SAMPLES = 1000;
+
+static void BuildSyntheticChain(std::vector<CBlockIndex>& vChain)
+{
+    FastRandomContext rng(true);
+    vChain.resize(SYNTHETIC_CHAIN_HEIGHT);
+    for (int nHeight = 0; nHeight < SYNTHETIC_CHAIN_HEIGHT; nHeight++) {
+        CBlockIndex& index = vChain[nHeight];
+        uint32_t r = rng.rand32(100);
+        CBlockHeader header;
+        header.nVersion = 4;
+        header.SetAlgo(r < 50 ? ALGO_SLOT1 : r < 85 ? ALGO_SLOT2 : ALGO_SLOT3);
+        index.nVersion = header.nVersion;
+        index.nHeight = nHeight;
+        index.pprev = nHeight ? &vChain[nHeight - 1] : NULL;
+        index.nTime = 1546300800 + nHeight * 120 + rng.rand32(60);
+        index.nBits = 0x1e0fffff;
+        index.BuildPrevAlgo();
+    }
+}
+
+static std::vector<const CBlockIndex*> RetargetTips(const std::vector<CBlockIndex>& vChain)
+{
+    FastRandomContext rng(true);
+    std::vector<const CBlockIndex*> vTips;
+    for (size_t i = 0; i < RETARGET_SAMPLES; i++)
+        vTips.push_back(&vChain[3000 + rng.rand32(SYNTHETIC_CHAIN_HEIGHT - 3000)]);
+    return vTips;
+}
+
+static void POW_GetNextWorkRequired(benchmark::State& state)
+{
+    const Consensus::Params& params = Params(CBaseChainParams::MAIN).GetConsensus();
+    std::vector<CBlockIndex> vChain;
+    BuildSyntheticChain(vChain);
+    std::vector<const CBlockIndex*> vTips = RetargetTips(vChain);
+    unsigned int nBits = 0;
+    while (state.KeepRunning()) {
+        for (const CBlockIndex* pindex : vTips)
+            for (int algo = 0; algo < NUM_ALGOS; algo++)
+                nBits ^= GetNextWorkRequired(pindex, NULL, algo, params);
+    }
+}
+
+static void POW_GetLastBlockIndexForAlgo(benchmark::State& state)
+{
+    std::vector<CBlockIndex> vChain;
+    BuildSyntheticChain(vChain);
+    std::vector<const CBlockIndex*> vTips = RetargetTips(vChain);
+    while (state.KeepRunning()) {
+        for (const CBlockIndex* pindex : vTips)
+            for (int algo = 0; algo < NUM_ALGOS; algo++)
+                assert(GetLastBlockIndexForAlgo(pindex, algo) != NULL);
+    }
+}
+
+BENCHMARK(POW_NeoScrypt);
+BENCHMARK(POW_Argon2d);
+BENCHMARK(POW_Lyra2CZ);
+BENCHMARK(POW_Argon2d_Cold);
+BENCHMARK(POW_NeoScrypt_Threads);
+BENCHMARK(POW_Argon2d_Threads);
+BENCHMARK(POW_Lyra2CZ_Threads);
+BENCHMARK(POW_Argon2d_Alloc);
+BENCHMARK(POW_Argon2d_Scratch);
+BENCHMARK(POW_GetNextWorkRequired);
+BENCHMARK(POW_GetLastBlockIndexForAlgo);
@@ -0,0 +1,121 @@
+// Copyright (c) 2019 The Kepler developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/kepler-config.h"
+#endif
+
+#include "bench.h"
+#include "chainparams.h"
+#include "compat.h"
+#include "net.h"
+#include "netbase.h"
+#include "util.h"
+
+#include <vector>
+
+#ifndef WIN32
+#include <sys/socket.h>
+
+/*
+ * Passes of the CConnman socket handler over a set of simulated peers, most
+ * of them idle. Each peer is a CNode on one end of a socketpair; every pass
+ * the other end of a few active peers gets an empty message written to it,
+ * SocketHandler() services whatever is ready, and then the messages of the
+ * active peers are taken off their queues like the message handler would.
+ *
+ * With select() every pass rebuilds and rescans its fd_sets over every peer,
+ * and descriptors at or above FD_SETSIZE can't be used at all. With epoll the
+ * registrations only change with the state of a peer and a pass only touches
+ * the peers that are ready.
+ */
+static const size_t ACTIVE_PEERS = 10;
+
+class CConnmanBench : public CConnman
+{
+public:
+    std::vector<CNode*> vLocal;
+    std::vector<SOCKET> vRemote;
+
+    CConnmanBench(SocketEventsMode mode, size_t nPeers) : CConnman(0x1337, 0x1337)
+    {
+        std::string strError;
+        bool fInit = InitSocketEvents(mode, strError);
+        assert(fInit);
+        interruptNet.reset();
+        nReceiveFloodSize = 1000 * DEFAULT_MAXRECEIVEBUFFER;
+        RaiseFileDescriptorLimit(2 * nPeers + 100);
+        for (size_t i = 0; i < nPeers; i++) {
+            int sv[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+                break;
+            if (mode == SOCKETEVENTS_SELECT && !IsSelectableSocket(sv[0])) {
+                close(sv[0]);
+                close(sv[1]);
+                break;
+            }
+            SOCKET hSocket = sv[0];
+            SetSocketNonBlocking(hSocket, true);
+            CNode* pnode = new CNode(i, NODE_NETWORK, 0, hSocket, CAddress(CService(), NODE_NONE), 0, 0, "", true);
+            pnode->AddRef();
+            {
+                LOCK(cs_vNodes);
+                vNodes.push_back(pnode);
+            }
+            UpdateSocketEvents(pnode);
+            vLocal.push_back(pnode);
+            vRemote.push_back(sv[1]);
+        }
+    }
+
+    ~CConnmanBench()
+    {
+        for (SOCKET& hSocket : vRemote)
+            CloseSocket(hSocket);
+    }
+
+    void Pass(size_t nPass)
+    {
+        // Wake up ACTIVE_PEERS peers spread evenly over the set
+        char pchMsg[CMessageHeader::HEADER_SIZE] = {};
+        size_t nStep = std::max(vRemote.size() / ACTIVE_PEERS, (size_t)1);
+        for (size_t i = nPass % nStep; i < vRemote.size(); i += nStep)
+            send(vRemote[i], pchMsg, sizeof(pchMsg), MSG_NOSIGNAL);
+
+        SocketHandler();
+
+        for (size_t i = nPass % nStep; i < vLocal.size(); i += nStep) {
+            LOCK(vLocal[i]->cs_vProcessMsg);
+            vLocal[i]->vProcessMsg.clear();
+            vLocal[i]->nProcessQueueSize = 0;
+        }
+    }
+};
+
+static void SocketHandler(benchmark::State& state, CConnman::SocketEventsMode mode, size_t nPeers)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    CConnmanBench connman(mode, nPeers);
+    size_t nPass = 0;
+    while (state.KeepRunning()) {
+        connman.Pass(nPass++);
+    }
+}
+
+// FD_SETSIZE is usually 1024, so select() gets at most ~500 socketpairs
+static void SOCKETS_Select_100(benchmark::State& state) { SocketHandler(state, CConnman::SOCKETEVENTS_SELECT, 100); }
+static void SOCKETS_Select_500(benchmark::State& state) { SocketHandler(state, CConnman::SOCKETEVENTS_SELECT, 500); }
+BENCHMARK(SOCKETS_Select_100);
+BENCHMARK(SOCKETS_Select_500);
+
+#ifdef USE_EPOLL
+static void SOCKETS_Epoll_100(benchmark::State& state) { SocketHandler(state, CConnman::SOCKETEVENTS_EPOLL, 100); }
+static void SOCKETS_Epoll_500(benchmark::State& state) { SocketHandler(state, CConnman::SOCKETEVENTS_EPOLL, 500); }
+static void SOCKETS_Epoll_2000(benchmark::State& state) { SocketHandler(state, CConnman::SOCKETEVENTS_EPOLL, 2000); }
+BENCHMARK(SOCKETS_Epoll_100);
+BENCHMARK(SOCKETS_Epoll_500);
+BENCHMARK(SOCKETS_Epoll_2000);
+#endif
+
+#endif // WIN32
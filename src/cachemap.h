@@ -7,6 +7,7 @@
 
 #include <map>
 #include <list>
+#include <set>
 #include <cstddef>
 
 #include "serialize.h"
@@ -40,7 +41,7 @@ struct CacheItem
 
 
 /**
- * Map like container that keeps the N most recently added items
+ * Map like container that keeps the N most recently added (or touched) items
  */
 template<typename K, typename V, typename Size = uint32_t>
 class CacheMap
@@ -132,6 +133,17 @@ public:
         return true;
     }
 
+    /// Make key the most recently added item, so it is pruned last
+    bool Touch(const K& key)
+    {
+        map_it it = mapIndex.find(key);
+        if(it == mapIndex.end()) {
+            return false;
+        }
+        listItems.splice(listItems.begin(), listItems, it->second);
+        return true;
+    }
+
     void Erase(const K& key)
     {
         map_it it = mapIndex.find(key);
@@ -186,4 +198,119 @@ private:
     }
 };
 
+/**
+ * CacheMap that also keeps the keys of each value, so that all items holding
+ * a given value can be erased without scanning the whole cache
+ */
+template<typename K, typename V, typename Size = uint32_t>
+class ValueIndexedCacheMap
+{
+public:
+    typedef Size size_type;
+
+    typedef CacheMap<K,V,Size> cache_map_t;
+
+    typedef typename cache_map_t::item_t item_t;
+
+    typedef typename cache_map_t::list_t list_t;
+
+    typedef std::set<K> key_s_t;
+
+    typedef std::map<V, key_s_t> value_map_t;
+
+    typedef typename value_map_t::iterator value_map_it;
+
+private:
+    cache_map_t cacheMap;
+
+    value_map_t mapKeysByValue;
+
+public:
+    ValueIndexedCacheMap(size_type nMaxSizeIn = 0)
+        : cacheMap(nMaxSizeIn),
+          mapKeysByValue()
+    {}
+
+    void Clear()
+    {
+        cacheMap.Clear();
+        mapKeysByValue.clear();
+    }
+
+    size_type GetMaxSize() const {
+        return cacheMap.GetMaxSize();
+    }
+
+    size_type GetSize() const {
+        return cacheMap.GetSize();
+    }
+
+    bool Insert(const K& key, const V& value)
+    {
+        if(cacheMap.HasKey(key)) {
+            return false;
+        }
+        // the oldest item is about to be pruned
+        if(cacheMap.GetSize() > 0 && cacheMap.GetSize() == cacheMap.GetMaxSize()) {
+            const item_t& item = cacheMap.GetItemList().back();
+            EraseKeyFromValue(item.key, item.value);
+        }
+        if(!cacheMap.Insert(key, value)) {
+            return false;
+        }
+        mapKeysByValue[value].insert(key);
+        return true;
+    }
+
+    bool HasKey(const K& key) const
+    {
+        return cacheMap.HasKey(key);
+    }
+
+    bool Get(const K& key, V& value) const
+    {
+        return cacheMap.Get(key, value);
+    }
+
+    void Erase(const K& key)
+    {
+        V value;
+        if(!cacheMap.Get(key, value)) {
+            return;
+        }
+        EraseKeyFromValue(key, value);
+        cacheMap.Erase(key);
+    }
+
+    // Erase all items holding value, in time proportional to their count
+    void EraseValue(const V& value)
+    {
+        value_map_it it = mapKeysByValue.find(value);
+        if(it == mapKeysByValue.end()) {
+            return;
+        }
+        for(const K& key : it->second) {
+            cacheMap.Erase(key);
+        }
+        mapKeysByValue.erase(it);
+    }
+
+    const list_t& GetItemList() const {
+        return cacheMap.GetItemList();
+    }
+
+private:
+    void EraseKeyFromValue(const K& key, const V& value)
+    {
+        value_map_it it = mapKeysByValue.find(value);
+        if(it == mapKeysByValue.end()) {
+            return;
+        }
+        it->second.erase(key);
+        if(it->second.empty()) {
+            mapKeysByValue.erase(it);
+        }
+    }
+};
+
 #endif /* CACHEMAP_H_ */
@@ -6,6 +6,8 @@
 #include "chain.h"
 #include "pow.h"
 
+#include <algorithm>
+
 /**
  * CChain implementation
  */
@@ -118,17 +120,34 @@ void CBlockIndex::BuildSkip()
         pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
 }
 
+void CBlockIndex::BuildPrevAlgo()
+{
+    for (int algo = 0; algo < NUM_ALGOS; algo++)
+        pprevAlgo[algo] = (pprev && pprev->GetAlgo() == algo) ? pprev : (pprev ? pprev->pprevAlgo[algo] : NULL);
+}
+
 const CBlockIndex* GetLastBlockIndexForAlgo(const CBlockIndex* pindex, int algo)
 {
-    for (;;)
-    {
-        if (!pindex)
-            return NULL;
-        if (pindex->GetAlgo() == algo)
-            return pindex;
-        pindex = pindex->pprev;
-    }
+    if (!pindex)
+        return NULL;
+    if (pindex->GetAlgo() == algo)
+        return pindex;
+    return pindex->pprevAlgo[algo];
 }
+bool GetAlgoByName(std::string strAlgo, int& algo)
+{
+    transform(strAlgo.begin(), strAlgo.end(), strAlgo.begin(), ::tolower);
+    if (strAlgo == "neoscrypt")
+        algo = ALGO_SLOT1;
+    else if (strAlgo == "argon2d" || strAlgo == "argon" || strAlgo == "argon2")
+        algo = ALGO_SLOT2;
+    else if (strAlgo == "lyra2cz" || strAlgo == "lyra2")
+        algo = ALGO_SLOT3;
+    else
+        return false;
+    return true;
+}
+
 std::string GetAlgoName(int algo, uint32_t time)
 {
     switch (algo)
@@ -145,6 +145,8 @@ enum BlockStatus: uint32_t {
     BLOCK_FAILED_VALID       =   32, //!< stage after last reached validness failed
     BLOCK_FAILED_CHILD       =   64, //!< descends from failed block
     BLOCK_FAILED_MASK        =   BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
+
+    BLOCK_HAVE_POWHASH       =  128, //!< hashPoW is known and stored in the block index record
 };
 
 /** The block chain is a tree shaped structure starting with the
@@ -164,6 +166,9 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip;
 
+    //! pointer to the index of the nearest predecessor mined with each algo, NULL if there is none
+    CBlockIndex* pprevAlgo[NUM_ALGOS];
+
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
@@ -198,6 +203,9 @@ public:
     unsigned int nBits;
     unsigned int nNonce;
 
+    //! Proof-of-work hash of the block header, null if it has not been computed yet
+    uint256 hashPoW;
+
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     int32_t nSequenceId;
 
@@ -209,6 +217,8 @@ public:
         phashBlock = NULL;
         pprev = NULL;
         pskip = NULL;
+        for (int algo = 0; algo < NUM_ALGOS; algo++)
+            pprevAlgo[algo] = NULL;
         nHeight = 0;
         nFile = 0;
         nDataPos = 0;
@@ -225,6 +235,7 @@ public:
         nTime          = 0;
         nBits          = 0;
         nNonce         = 0;
+        hashPoW        = uint256();
     }
 
     CBlockIndex()
@@ -351,6 +362,9 @@ public:
     //! Build the skiplist pointer for this entry.
     void BuildSkip();
 
+    //! Build the per-algo predecessor pointers for this entry. pprev must already have them.
+    void BuildPrevAlgo();
+
     //! Efficiently find an ancestor of this block.
     CBlockIndex* GetAncestor(int height);
     const CBlockIndex* GetAncestor(int height) const;
@@ -365,6 +379,8 @@ public:
 
 /** Return the index to the last block of algo **/
 const CBlockIndex* GetLastBlockIndexForAlgo(const CBlockIndex* pindex, int algo);
+/** Parse an algorithm name as accepted by -algo, returns false if it is unknown **/
+bool GetAlgoByName(std::string strAlgo, int& algo);
 /** return current algorithm name from nVersion and timestamp **/
 std::string GetAlgoName(int algo, uint32_t time);
 
@@ -412,6 +428,8 @@ public:
         READWRITE(nTime);
         READWRITE(nBits);
         READWRITE(nNonce);
+        if ((nStatus & BLOCK_HAVE_POWHASH) && !(s.GetType() & SER_GETHASH))
+            READWRITE(hashPoW);
     }
 
     uint256 GetBlockHash() const
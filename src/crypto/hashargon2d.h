@@ -9,24 +9,41 @@
 #include "serialize.h"
 
 #include "argon2/argon2.h"
+#include "crypto/powscratch.h"
 
 #include <vector>
 
 template<typename T1>
 inline uint256 HashArgon2d(const T1 pbegin, const T1 pend)
 {
-    uint32_t t_cost = 1; // 1 iteration
-    uint32_t m_cost = 4096; // use 4MB
-    uint32_t parallelism = 1; // 1 thread, 2 lanes
-    
     static unsigned char pblank[1];
     size_t pwdlen = (pend - pbegin) * sizeof(pbegin[0]);
     
     uint256 hash;
-    size_t hashlen = 32;
     
-    argon2d_hash_raw(t_cost, m_cost, parallelism, (pbegin == pend ? pblank : (unsigned char*)&pbegin[0]), pwdlen,
-                    (pbegin == pend ? pblank : (unsigned char*)&pbegin[0]), pwdlen, (unsigned char*)&hash, hashlen);
+    argon2_context context;
+    context.out = (uint8_t*)&hash;
+    context.outlen = 32;
+    context.pwd = (pbegin == pend ? pblank : (uint8_t*)&pbegin[0]);
+    context.pwdlen = pwdlen;
+    context.salt = (pbegin == pend ? pblank : (uint8_t*)&pbegin[0]);
+    context.saltlen = pwdlen;
+    context.secret = NULL;
+    context.secretlen = 0;
+    context.ad = NULL;
+    context.adlen = 0;
+    context.t_cost = 1; // 1 iteration
+    context.m_cost = 4096; // use 4MB
+    context.lanes = 1; // 1 thread, 1 lane
+    context.threads = 1;
+    // Reuse the calling thread's scratch arena instead of allocating 4MB per hash
+    context.allocate_cbk = PoWScratchArgon2Allocate;
+    context.free_cbk = PoWScratchArgon2Free;
+    context.flags = ARGON2_DEFAULT_FLAGS;
+    context.version = ARGON2_VERSION_NUMBER;
+
+    if (argon2_ctx(&context, Argon2_d) != ARGON2_OK)
+        memset(&hash, 0xff, sizeof(hash)); // fails any target
     
     return hash;
 }
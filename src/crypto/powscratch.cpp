@@ -0,0 +1,49 @@
+// Copyright (c) 2019 The Kepler developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/powscratch.h"
+
+#include <stdlib.h>
+
+unsigned char* CPoWScratch::Reserve(size_t nBytes)
+{
+    if (nBytes > nSize) {
+        // Keep the old buffer if the bigger one can't be had
+        unsigned char* pnew = static_cast<unsigned char*>(malloc(nBytes));
+        if (pnew == NULL)
+            return NULL;
+        free(pmem);
+        pmem = pnew;
+        nSize = nBytes;
+    }
+    return pmem;
+}
+
+void CPoWScratch::Release()
+{
+    free(pmem);
+    pmem = NULL;
+    nSize = 0;
+}
+
+CPoWScratch& PoWScratch()
+{
+    static thread_local CPoWScratch scratch;
+    return scratch;
+}
+
+int PoWScratchArgon2Allocate(uint8_t** memory, size_t nBytes)
+{
+    *memory = PoWScratch().Reserve(nBytes);
+    if (*memory == NULL) // arena could not grow, hash in memory of its own
+        *memory = static_cast<uint8_t*>(malloc(nBytes));
+    return *memory == NULL ? -1 : 0;
+}
+
+void PoWScratchArgon2Free(uint8_t* memory, size_t nBytes)
+{
+    // Arena memory stays with the thread for the next hash
+    if (memory != PoWScratch().Data())
+        free(memory);
+}
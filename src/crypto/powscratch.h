@@ -0,0 +1,49 @@
+// Copyright (c) 2019 The Kepler developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_POWSCRATCH_H
+#define BITCOIN_CRYPTO_POWSCRATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Scratch memory for the Argon2d PoW hash. It is kept across hashes so the
+ * 4MB matrix doesn't have to be allocated (and its pages faulted in) on every
+ * call. Each thread has its own arena, see PoWScratch().
+ */
+class CPoWScratch
+{
+private:
+    unsigned char* pmem;
+    size_t nSize;
+
+    CPoWScratch(const CPoWScratch&);
+    CPoWScratch& operator=(const CPoWScratch&);
+
+public:
+    CPoWScratch() : pmem(NULL), nSize(0) {}
+    ~CPoWScratch() { Release(); }
+
+    /**
+     * Return at least nBytes of memory, valid until the next Reserve() or Release().
+     * Returns NULL, leaving the current memory in place, if it can't grow.
+     */
+    unsigned char* Reserve(size_t nBytes);
+
+    /** Free the memory held by the arena */
+    void Release();
+
+    unsigned char* Data() const { return pmem; }
+    size_t Size() const { return nSize; }
+};
+
+/** Return the calling thread's scratch arena */
+CPoWScratch& PoWScratch();
+
+/** argon2_context allocator callbacks handing out the calling thread's arena */
+int PoWScratchArgon2Allocate(uint8_t** memory, size_t nBytes);
+void PoWScratchArgon2Free(uint8_t* memory, size_t nBytes);
+
+#endif // BITCOIN_CRYPTO_POWSCRATCH_H
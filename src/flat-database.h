@@ -11,8 +11,282 @@
 #include "streams.h"
 #include "util.h"
 
+#include <map>
+#include <stdexcept>
+
 #include <boost/filesystem.hpp>
 
+/** Thrown when a chunk read by CChunkedHashReader doesn't match its checksum */
+class chunk_hash_error : public std::runtime_error
+{
+public:
+    explicit chunk_hash_error(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+/** Where a chunk of a CFlatDB snapshot is stored in its chunk file */
+struct CFlatDBChunk
+{
+    uint256 hash;
+    uint64_t nPos;
+    uint32_t nSize;
+
+    CFlatDBChunk() : hash(), nPos(0), nSize(0) {}
+    CFlatDBChunk(const uint256& hashIn, uint64_t nPosIn, uint32_t nSizeIn) : hash(hashIn), nPos(nPosIn), nSize(nSizeIn) {}
+
+    /** Bytes taken by the chunk record: its size, its data and its hash */
+    uint64_t GetRecordSize() const { return sizeof(nSize) + nSize + sizeof(hash); }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hash);
+        READWRITE(nPos);
+        READWRITE(nSize);
+    }
+};
+
+/** The chunks a CFlatDB snapshot is made of, in stream order */
+struct CFlatDBManifest
+{
+    // the chunks are in <file>.<nGeneration>.chunks
+    uint32_t nGeneration;
+    // bytes of the chunk file in use, anything after it is left from an interrupted snapshot
+    uint64_t nStoreSize;
+    std::vector<CFlatDBChunk> vChunks;
+
+    CFlatDBManifest() : nGeneration(0), nStoreSize(0), vChunks() {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nGeneration);
+        READWRITE(nStoreSize);
+        READWRITE(vChunks);
+    }
+};
+
+/**
+ * Serialization stream writing checksummed chunks to a chunk file. Chunk
+ * boundaries are picked by a rolling hash of the last 64 bytes, so data that
+ * didn't change since the previous snapshot is cut into the same chunks even
+ * when something was inserted or removed before it. Chunks that are in the
+ * file already are only referenced, only new ones are appended. Each chunk
+ * record is its size, its data and the double-SHA256 of the data, so the
+ * writer only holds one chunk in memory.
+ */
+class CChunkedHashWriter
+{
+public:
+    static const uint32_t MIN_CHUNK_SIZE = 1 << 14;
+    static const uint32_t CHUNK_SIZE = 1 << 20;
+    // 16 bits of the rolling hash have to be zero, so chunks are ~64kB past MIN_CHUNK_SIZE
+    static const uint64_t CHUNK_BOUNDARY_MASK = 0xffff000000000000ULL;
+
+private:
+    CAutoFile& file;
+    std::map<uint256, CFlatDBChunk>& mapStored;
+    std::vector<CFlatDBChunk>& vChunks;
+    uint64_t nFilePos;
+    uint64_t nBytesWritten;
+    std::vector<char> vchChunk;
+    uint64_t nRollingHash;
+
+    /** Random values for the rolling hash, the same ones every time so chunks can be reused */
+    static const uint64_t* GetGearTable()
+    {
+        struct CGearTable {
+            uint64_t vGear[256];
+            CGearTable()
+            {
+                // splitmix64
+                uint64_t nState = 0;
+                for (int i = 0; i < 256; i++) {
+                    uint64_t z = (nState += 0x9e3779b97f4a7c15ULL);
+                    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                    vGear[i] = z ^ (z >> 31);
+                }
+            }
+        };
+        static const CGearTable table;
+        return table.vGear;
+    }
+
+    void WriteChunk()
+    {
+        uint256 hash = Hash(vchChunk.begin(), vchChunk.end());
+        std::map<uint256, CFlatDBChunk>::iterator it = mapStored.find(hash);
+        if (it == mapStored.end()) {
+            uint32_t nSize = vchChunk.size();
+            file << nSize;
+            file.write(&vchChunk[0], nSize);
+            file << hash;
+            it = mapStored.emplace(hash, CFlatDBChunk(hash, nFilePos, nSize)).first;
+            nFilePos += it->second.GetRecordSize();
+            nBytesWritten += it->second.GetRecordSize();
+        }
+        vChunks.push_back(it->second);
+        vchChunk.clear();
+        nRollingHash = 0;
+    }
+
+public:
+    /**
+     * Write to fileIn, positioned at nFilePosIn, reusing the chunks of
+     * mapStoredIn. The chunks of the stream are added to vChunksIn.
+     */
+    CChunkedHashWriter(CAutoFile& fileIn, std::map<uint256, CFlatDBChunk>& mapStoredIn, std::vector<CFlatDBChunk>& vChunksIn, uint64_t nFilePosIn) :
+        file(fileIn),
+        mapStored(mapStoredIn),
+        vChunks(vChunksIn),
+        nFilePos(nFilePosIn),
+        nBytesWritten(0),
+        nRollingHash(0)
+    {
+        vchChunk.reserve(CHUNK_SIZE);
+    }
+
+    int GetType() const { return file.GetType(); }
+    int GetVersion() const { return file.GetVersion(); }
+
+    /** Bytes buffered for the current chunk */
+    size_t size() const { return vchChunk.size(); }
+
+    /** Position in the chunk file after the last chunk appended */
+    uint64_t GetFilePos() const { return nFilePos; }
+
+    /** Bytes appended to the chunk file, the rest of the stream was stored already */
+    uint64_t GetBytesWritten() const { return nBytesWritten; }
+
+    void write(const char* pch, size_t nSize)
+    {
+        const uint64_t* vGear = GetGearTable();
+        for (size_t i = 0; i < nSize; i++) {
+            vchChunk.push_back(pch[i]);
+            nRollingHash = (nRollingHash << 1) + vGear[(unsigned char)pch[i]];
+            if ((vchChunk.size() >= MIN_CHUNK_SIZE && (nRollingHash & CHUNK_BOUNDARY_MASK) == 0) || vchChunk.size() == CHUNK_SIZE) {
+                WriteChunk();
+            }
+        }
+    }
+
+    /** Write out the last chunk */
+    void Finalize()
+    {
+        if (!vchChunk.empty()) {
+            WriteChunk();
+        }
+    }
+
+    template<typename T>
+    CChunkedHashWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return (*this);
+    }
+};
+
+/**
+ * Reads the chunks listed in a snapshot manifest as one stream, verifying
+ * every chunk before using its data.
+ */
+class CChunkedHashReader
+{
+private:
+    CAutoFile& file;
+    const std::vector<CFlatDBChunk>& vChunks;
+    size_t nNextChunk;
+    std::vector<char> vchChunk;
+    size_t nPos;
+    bool fEnd;
+
+    void ReadChunk()
+    {
+        if (nNextChunk == vChunks.size()) {
+            vchChunk.clear();
+            nPos = 0;
+            fEnd = true;
+            return;
+        }
+        const CFlatDBChunk& chunk = vChunks[nNextChunk++];
+        if (fseek(file.Get(), chunk.nPos, SEEK_SET) != 0) {
+            throw std::ios_base::failure("CChunkedHashReader::ReadChunk: seek failed");
+        }
+        uint32_t nSize;
+        file >> nSize;
+        if (nSize > CChunkedHashWriter::CHUNK_SIZE) {
+            throw chunk_hash_error("CChunkedHashReader::ReadChunk: chunk too large");
+        }
+        vchChunk.resize(nSize);
+        if (nSize > 0) {
+            file.read(&vchChunk[0], nSize);
+        }
+        uint256 hashIn;
+        file >> hashIn;
+        if (hashIn != Hash(vchChunk.begin(), vchChunk.end())) {
+            throw chunk_hash_error("CChunkedHashReader::ReadChunk: checksum mismatch");
+        }
+        if (nSize == 0 || nSize != chunk.nSize || hashIn != chunk.hash) {
+            throw chunk_hash_error("CChunkedHashReader::ReadChunk: chunk doesn't match the manifest");
+        }
+        nPos = 0;
+    }
+
+public:
+    CChunkedHashReader(CAutoFile& fileIn, const std::vector<CFlatDBChunk>& vChunksIn) :
+        file(fileIn),
+        vChunks(vChunksIn),
+        nNextChunk(0),
+        nPos(0),
+        fEnd(false)
+    {}
+
+    int GetType() const { return file.GetType(); }
+    int GetVersion() const { return file.GetVersion(); }
+
+    /** Bytes left in the current chunk, 0 only at the end of the stream */
+    size_t size()
+    {
+        if (nPos == vchChunk.size() && !fEnd) {
+            ReadChunk();
+        }
+        return vchChunk.size() - nPos;
+    }
+
+    void read(char* pch, size_t nSize)
+    {
+        while (nSize > 0) {
+            if (nPos == vchChunk.size()) {
+                if (fEnd) {
+                    throw std::ios_base::failure("CChunkedHashReader::read: end of data");
+                }
+                ReadChunk();
+                continue;
+            }
+            size_t nNow = std::min(nSize, vchChunk.size() - nPos);
+            memcpy(pch, &vchChunk[nPos], nNow);
+            nPos += nNow;
+            pch += nNow;
+            nSize -= nNow;
+        }
+    }
+
+    /** Return true if all data was consumed and the end marker follows */
+    bool AtEnd()
+    {
+        return size() == 0;
+    }
+
+    template<typename T>
+    CChunkedHashReader& operator>>(T& obj)
+    {
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+};
+
 /** 
 *   Generic Dumping and Loading
 *   ---------------------------
@@ -33,46 +307,259 @@ private:
         IncorrectFormat
     };
 
+    // snapshot manifests, the chunks are in a separate chunk file
+    static constexpr char SNAPSHOT_FORMAT_MARKER[8] = {'F', 'L', 'A', 'T', 'D', 'B', 0, 3};
+
     boost::filesystem::path pathDB;
     std::string strFilename;
     std::string strMagicMessage;
 
-    bool Write(const T& objToSave)
+    boost::filesystem::path GetChunkFilePath(uint32_t nGeneration) const
+    {
+        return boost::filesystem::path(pathDB.string() + strprintf(".%u.chunks", nGeneration));
+    }
+
+    /** Read the manifest of the last snapshot */
+    ReadResult ReadManifest(CFlatDBManifest& manifest)
     {
-        // LOCK(objToSave.cs);
+        // open input file, and associate with CAutoFile
+        FILE *file = fopen(pathDB.string().c_str(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return FileError;
+
+        char pchMarker[sizeof(SNAPSHOT_FORMAT_MARKER)];
+        uint256 hashIn;
+        try {
+            filein >> FLATDATA(pchMarker);
+            if (memcmp(pchMarker, SNAPSHOT_FORMAT_MARKER, sizeof(pchMarker)))
+                return IncorrectFormat;
+            filein >> manifest;
+            filein >> hashIn;
+        }
+        catch (std::exception &e) {
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            return HashReadError;
+        }
+        if (hashIn != SerializeHash(manifest, SER_DISK, CLIENT_VERSION))
+        {
+            error("%s: Checksum mismatch, data corrupted", __func__);
+            return IncorrectHash;
+        }
+        return Ok;
+    }
 
+    /**
+     * Write a snapshot of objToSave. Chunks that are in the chunk file of the
+     * previous snapshot already are reused, so only what changed since then is
+     * written. Once less than half of the chunk file is in use, a new chunk
+     * file is started instead and the old one removed.
+     */
+    bool Write(const T& objToSave)
+    {
         int64_t nStart = GetTimeMillis();
 
-        // serialize, checksum data up to that point, then append checksum
+        // The object holds its lock while serializing itself, so it's serialized into
+        // memory first and the lock isn't held while chunking and writing to disk
         CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-        ssObj << strMagicMessage; // specific magic message for this type of object
-        ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
         ssObj << objToSave;
-        uint256 hash = Hash(ssObj.begin(), ssObj.end());
-        ssObj << hash;
+        int64_t nSerialized = GetTimeMillis();
+
+        CFlatDBManifest manifestOld;
+        bool fHaveOld = ReadManifest(manifestOld) == Ok;
+        bool fReuse = false;
+        std::map<uint256, CFlatDBChunk> mapStored;
+        if (fHaveOld && boost::filesystem::exists(GetChunkFilePath(manifestOld.nGeneration))) {
+            uint64_t nLiveSize = 0;
+            for (const auto& chunk : manifestOld.vChunks) {
+                if (mapStored.emplace(chunk.hash, chunk).second)
+                    nLiveSize += chunk.GetRecordSize();
+            }
+            fReuse = nLiveSize * 2 >= manifestOld.nStoreSize;
+        }
 
-        // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        CFlatDBManifest manifest;
+        FILE *file;
+        if (fReuse) {
+            manifest.nGeneration = manifestOld.nGeneration;
+            file = fopen(GetChunkFilePath(manifest.nGeneration).string().c_str(), "r+b");
+            // new chunks go after the ones in use, over anything left from an interrupted snapshot
+            if (file && fseek(file, manifestOld.nStoreSize, SEEK_SET) != 0) {
+                fclose(file);
+                file = NULL;
+            }
+        } else {
+            mapStored.clear();
+            manifest.nGeneration = fHaveOld ? manifestOld.nGeneration + 1 : 0;
+            file = fopen(GetChunkFilePath(manifest.nGeneration).string().c_str(), "wb");
+        }
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, GetChunkFilePath(manifest.nGeneration).string());
 
-        // Write and commit header, data
+        // serialize straight into the chunk file, checksumming each chunk
+        uint64_t nBytesWritten;
         try {
-            fileout << ssObj;
+            CChunkedHashWriter writer(fileout, mapStored, manifest.vChunks, fReuse ? manifestOld.nStoreSize : 0);
+            writer << strMagicMessage; // specific magic message for this type of object
+            writer << FLATDATA(Params().MessageStart()); // network specific magic number
+            writer.write(ssObj.data(), ssObj.size());
+            writer.Finalize();
+            manifest.nStoreSize = writer.GetFilePos();
+            nBytesWritten = writer.GetBytesWritten();
         }
         catch (std::exception &e) {
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        FileCommit(fileout.Get());
         fileout.fclose();
 
-        LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
+        // the manifest only refers to chunks on disk, write it to a temporary file and rename it into place
+        boost::filesystem::path pathTmp = pathDB;
+        pathTmp += ".new";
+        CAutoFile manifestout(fopen(pathTmp.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+        if (manifestout.IsNull())
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
+        try {
+            manifestout << FLATDATA(SNAPSHOT_FORMAT_MARKER);
+            manifestout << manifest;
+            manifestout << SerializeHash(manifest, SER_DISK, CLIENT_VERSION);
+        }
+        catch (std::exception &e) {
+            return error("%s: Serialize or I/O error - %s", __func__, e.what());
+        }
+        FileCommit(manifestout.Get());
+        manifestout.fclose();
+
+        if (!RenameOver(pathTmp, pathDB))
+            return error("%s: Rename-into-place failed for %s", __func__, pathDB.string());
+
+        if (fHaveOld && !fReuse) {
+            boost::system::error_code ec;
+            boost::filesystem::remove(GetChunkFilePath(manifestOld.nGeneration), ec);
+        }
+
+        LogPrintf("Written info to %s  %dms (%dms serializing), %d of %d bytes new\n", strFilename, GetTimeMillis() - nStart, nSerialized - nStart, nBytesWritten, manifest.nStoreSize);
         LogPrintf("     %s\n", objToSave.ToString());
 
         return true;
     }
 
+    /** Read the header and, unless it's a dry run, the object from a stream of chunks */
+    ReadResult ReadChunked(CChunkedHashReader& reader, T& objToLoad, bool fDryRun)
+    {
+        unsigned char pchMsgTmp[4];
+        std::string strMagicMessageTmp;
+        try {
+            // de-serialize file header (file specific magic message) and ..
+            reader >> strMagicMessageTmp;
+
+            // ... verify the message matches predefined one
+            if (strMagicMessage != strMagicMessageTmp)
+            {
+                error("%s: Invalid magic message", __func__);
+                return IncorrectMagicMessage;
+            }
+
+            // de-serialize file header (network specific magic number) and ..
+            reader >> FLATDATA(pchMsgTmp);
+
+            // ... verify the network matches ours
+            if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+            {
+                error("%s: Invalid network magic number", __func__);
+                return IncorrectMagicNumber;
+            }
+        }
+        catch (const chunk_hash_error &e) {
+            error("%s: %s, data corrupted", __func__, e.what());
+            return IncorrectHash;
+        }
+        catch (std::exception &e) {
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            return HashReadError;
+        }
+
+        if (fDryRun) {
+            return Ok;
+        }
+
+        try {
+            // de-serialize data into T object
+            reader >> objToLoad;
+            if (!reader.AtEnd())
+                throw std::ios_base::failure("unexpected data after object");
+        }
+        catch (const chunk_hash_error &e) {
+            objToLoad.Clear();
+            error("%s: %s, data corrupted", __func__, e.what());
+            return IncorrectHash;
+        }
+        catch (std::exception &e) {
+            objToLoad.Clear();
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            return IncorrectFormat;
+        }
+        return Ok;
+    }
+
+    /**
+     * Read a file written by Write(). A dry run only verifies the file header,
+     * files in the format used before snapshots are handed to ReadLegacy().
+     */
     ReadResult Read(T& objToLoad, bool fDryRun = false)
+    {
+        int64_t nStart = GetTimeMillis();
+        // open input file, and associate with CAutoFile
+        FILE *file = fopen(pathDB.string().c_str(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+        {
+            error("%s: Failed to open file %s", __func__, pathDB.string());
+            return FileError;
+        }
+
+        char pchMarker[sizeof(SNAPSHOT_FORMAT_MARKER)];
+        try {
+            filein >> FLATDATA(pchMarker);
+        }
+        catch (std::exception &e) {
+            pchMarker[0] = 0;
+        }
+
+        ReadResult result;
+        if (!memcmp(pchMarker, SNAPSHOT_FORMAT_MARKER, sizeof(pchMarker))) {
+            filein.fclose();
+            CFlatDBManifest manifest;
+            result = ReadManifest(manifest);
+            if (result != Ok)
+                return result;
+            CAutoFile fileChunks(fopen(GetChunkFilePath(manifest.nGeneration).string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+            if (fileChunks.IsNull())
+            {
+                error("%s: Failed to open file %s", __func__, GetChunkFilePath(manifest.nGeneration).string());
+                return FileError;
+            }
+            CChunkedHashReader reader(fileChunks, manifest.vChunks);
+            result = ReadChunked(reader, objToLoad, fDryRun);
+        } else {
+            filein.fclose();
+            return ReadLegacy(objToLoad, fDryRun);
+        }
+        if (result != Ok || fDryRun)
+            return result;
+
+        LogPrintf("Loaded info from %s  %dms\n", strFilename, GetTimeMillis() - nStart);
+        LogPrintf("     %s\n", objToLoad.ToString());
+        LogPrintf("%s: Cleaning....\n", __func__);
+        objToLoad.CheckAndRemove();
+        LogPrintf("     %s\n", objToLoad.ToString());
+
+        return Ok;
+    }
+
+    /** Read a file in the format used before chunked checksums, only needed to upgrade */
+    ReadResult ReadLegacy(T& objToLoad, bool fDryRun = false)
     {
         //LOCK(objToLoad.cs);
 
@@ -225,5 +712,7 @@ public:
 
 };
 
+template<typename T>
+constexpr char CFlatDB<T>::SNAPSHOT_FORMAT_MARKER[8];
 
 #endif
@@ -37,6 +37,7 @@ CGovernanceObject::CGovernanceObject():
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    mapVoteTally(),
     cmmapOrphanVotes(),
     fileVotes()
 {
@@ -65,6 +66,7 @@ CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevision
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    mapVoteTally(),
     cmmapOrphanVotes(),
     fileVotes()
 {
@@ -93,6 +95,7 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other):
     fExpired(other.fExpired),
     fUnparsable(other.fUnparsable),
     mapCurrentMNVotes(other.mapCurrentMNVotes),
+    mapVoteTally(other.mapVoteTally),
     cmmapOrphanVotes(other.cmmapOrphanVotes),
     fileVotes(other.fileVotes)
 {}
@@ -199,6 +202,8 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         return false;
     }
 
+    UpdateVoteTally(eSignal, voteInstanceRef.eOutcome, -1);
+    UpdateVoteTally(eSignal, vote.GetOutcome(), 1);
     voteInstanceRef = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
     fileVotes.AddVote(vote);
     fDirtyCache = true;
@@ -213,6 +218,9 @@ void CGovernanceObject::ClearMasternodeVotes()
     while(it != mapCurrentMNVotes.end()) {
         if(!mnodeman.Has(it->first)) {
             fileVotes.RemoveVotesFromMasternode(it->first);
+            for (const auto& instancePair : it->second.mapInstances) {
+                UpdateVoteTally(instancePair.first, instancePair.second.eOutcome, -1);
+            }
             mapCurrentMNVotes.erase(it++);
         }
         else {
@@ -221,6 +229,30 @@ void CGovernanceObject::ClearMasternodeVotes()
     }
 }
 
+void CGovernanceObject::UpdateVoteTally(int nSignal, vote_outcome_enum_t eOutcome, int nDelta)
+{
+    // instances without an outcome are left behind by rejected votes, they are never counted
+    if(eOutcome == VOTE_OUTCOME_NONE) {
+        return;
+    }
+    std::pair<int, int> key(nSignal, int(eOutcome));
+    int& nCount = mapVoteTally[key];
+    nCount += nDelta;
+    if(nCount == 0) {
+        mapVoteTally.erase(key);
+    }
+}
+
+void CGovernanceObject::RebuildVoteTally()
+{
+    mapVoteTally.clear();
+    for (const auto& votepair : mapCurrentMNVotes) {
+        for (const auto& instancePair : votepair.second.mapInstances) {
+            UpdateVoteTally(instancePair.first, instancePair.second.eOutcome, 1);
+        }
+    }
+}
+
 std::string CGovernanceObject::GetSignatureMessage() const
 {
     LOCK(cs);
@@ -636,15 +668,8 @@ int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote
 {
     LOCK(cs);
 
-    int nCount = 0;
-    for (const auto& votepair : mapCurrentMNVotes) {
-        const vote_rec_t& recVote = votepair.second;
-        vote_instance_m_cit it2 = recVote.mapInstances.find(eVoteSignalIn);
-        if(it2 != recVote.mapInstances.end() && it2->second.eOutcome == eVoteOutcomeIn) {
-            ++nCount;
-        }
-    }
-    return nCount;
+    vote_tally_m_cit it = mapVoteTally.find(std::make_pair(int(eVoteSignalIn), int(eVoteOutcomeIn)));
+    return it == mapVoteTally.end() ? 0 : it->second;
 }
 
 /**
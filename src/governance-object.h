@@ -122,6 +122,10 @@ public: // Types
 
     typedef CacheMultiMap<COutPoint, vote_time_pair_t> vote_cmm_t;
 
+    typedef std::map<std::pair<int, int>, int> vote_tally_m_t;
+
+    typedef vote_tally_m_t::const_iterator vote_tally_m_cit;
+
 private:
     /// critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -182,6 +186,9 @@ private:
 
     vote_m_t mapCurrentMNVotes;
 
+    /// Number of current votes by (signal, outcome), kept in step with mapCurrentMNVotes
+    vote_tally_m_t mapVoteTally;
+
     /// Limited map of votes orphaned by MN
     vote_cmm_t cmmapOrphanVotes;
 
@@ -349,6 +356,9 @@ public:
             READWRITE(fExpired);
             READWRITE(mapCurrentMNVotes);
             READWRITE(fileVotes);
+            if(ser_action.ForRead()) {
+                RebuildVoteTally();
+            }
             LogPrint("gobject", "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
         }
 
@@ -374,6 +384,9 @@ private:
     /// Called when MN's which have voted on this object have been removed
     void ClearMasternodeVotes();
 
+    void UpdateVoteTally(int nSignal, vote_outcome_enum_t eOutcome, int nDelta);
+    void RebuildVoteTally();
+
     void CheckOrphanVotes(CConnman& connman);
 
 };
@@ -4,29 +4,123 @@
 
 #include "governance-votedb.h"
 
-CGovernanceObjectVoteFile::CGovernanceObjectVoteFile()
-    : nMemoryVotes(0),
-      listVotes(),
-      mapVoteIndex()
+#include "dbwrapper.h"
+#include "util.h"
+
+#include <limits>
+
+static const char DB_GOVERNANCE_VOTE = 'v';
+
+CGovernanceVoteStore governanceVotes;
+
+CGovernanceVoteStore::CGovernanceVoteStore()
+    : cs(),
+      db(),
+      cacheVotes(std::numeric_limits<uint32_t>::max())
 {}
 
-CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other)
-    : nMemoryVotes(other.nMemoryVotes),
-      listVotes(other.listVotes),
-      mapVoteIndex()
+CGovernanceVoteStore::~CGovernanceVoteStore()
+{}
+
+void CGovernanceVoteStore::Init(const boost::filesystem::path& path, size_t nDBCacheSize, unsigned int nCacheVotes, bool fMemory, bool fWipe)
+{
+    LOCK(cs);
+    db.reset(new CDBWrapper(path, nDBCacheSize, fMemory, fWipe));
+    // votes only held in memory so far must not get lost when the cache gets bounded
+    for (const auto& item : cacheVotes.GetItemList()) {
+        db->Write(std::make_pair(DB_GOVERNANCE_VOTE, item.key), *item.value);
+    }
+    cacheVotes.Clear();
+    cacheVotes.SetMaxSize(std::max(nCacheVotes, 1u));
+}
+
+void CGovernanceVoteStore::Close()
+{
+    LOCK(cs);
+    db.reset();
+    cacheVotes.Clear();
+    cacheVotes.SetMaxSize(std::numeric_limits<uint32_t>::max());
+}
+
+void CGovernanceVoteStore::Write(const CGovernanceVote& vote)
+{
+    LOCK(cs);
+    uint256 nHash = vote.GetHash();
+    if (db) {
+        db->Write(std::make_pair(DB_GOVERNANCE_VOTE, nHash), vote);
+    }
+    cacheVotes.Insert(nHash, std::make_shared<const CGovernanceVote>(vote));
+}
+
+CGovernanceVoteStore::vote_ptr_t CGovernanceVoteStore::Read(const uint256& nHash) const
+{
+    LOCK(cs);
+    vote_ptr_t pvote;
+    if (cacheVotes.Get(nHash, pvote)) {
+        return pvote;
+    }
+    CGovernanceVote vote;
+    if (!db || !db->Read(std::make_pair(DB_GOVERNANCE_VOTE, nHash), vote)) {
+        return nullptr;
+    }
+    pvote = std::make_shared<const CGovernanceVote>(vote);
+    cacheVotes.Insert(nHash, pvote);
+    return pvote;
+}
+
+void CGovernanceVoteStore::Erase(const uint256& nHash)
+{
+    LOCK(cs);
+    if (db) {
+        db->Erase(std::make_pair(DB_GOVERNANCE_VOTE, nHash));
+    }
+    cacheVotes.Erase(nHash);
+}
+
+int CGovernanceVoteStore::EraseUnreferenced(const std::function<bool(const uint256& nHash, const CGovernanceVote& vote)>& fReferenced)
 {
-    RebuildIndex();
+    LOCK(cs);
+    if (!db) {
+        return 0;
+    }
+
+    int nErased = 0;
+    CDBBatch batch(*db);
+    std::unique_ptr<CDBIterator> pcursor(db->NewIterator());
+    pcursor->Seek(std::make_pair(DB_GOVERNANCE_VOTE, uint256()));
+    while (pcursor->Valid()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_GOVERNANCE_VOTE) {
+            break;
+        }
+        CGovernanceVote vote;
+        if (!pcursor->GetValue(vote) || !fReferenced(key.second, vote)) {
+            batch.Erase(key);
+            cacheVotes.Erase(key.second);
+            ++nErased;
+        }
+        pcursor->Next();
+    }
+    db->WriteBatch(batch);
+    return nErased;
 }
 
+CGovernanceObjectVoteFile::CGovernanceObjectVoteFile()
+    : mapVoteIndex()
+{}
+
+CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other)
+    : mapVoteIndex(other.mapVoteIndex)
+{}
+
 void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
 {
     uint256 nHash = vote.GetHash();
     // make sure to never add/update already known votes
     if (HasVote(nHash))
         return;
-    listVotes.push_front(vote);
-    mapVoteIndex.emplace(nHash, listVotes.begin());
-    ++nMemoryVotes;
+    mapVoteIndex.emplace(nHash, vote.GetMasternodeOutpoint());
+    governanceVotes.Write(vote);
 }
 
 bool CGovernanceObjectVoteFile::HasVote(const uint256& nHash) const
@@ -34,33 +128,53 @@ bool CGovernanceObjectVoteFile::HasVote(const uint256& nHash) const
     return mapVoteIndex.find(nHash) != mapVoteIndex.end();
 }
 
+CGovernanceVoteStore::vote_ptr_t CGovernanceObjectVoteFile::GetVote(const uint256& nHash) const
+{
+    if(!HasVote(nHash)) {
+        return nullptr;
+    }
+    return governanceVotes.Read(nHash);
+}
+
 bool CGovernanceObjectVoteFile::SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const
 {
-    vote_m_cit it = mapVoteIndex.find(nHash);
-    if(it == mapVoteIndex.end()) {
+    CGovernanceVoteStore::vote_ptr_t pvote = GetVote(nHash);
+    if(!pvote) {
         return false;
     }
-    ss << *(it->second);
+    ss << *pvote;
     return true;
 }
 
 std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
 {
     std::vector<CGovernanceVote> vecResult;
-    for(vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
-        vecResult.push_back(*it);
+    for(vote_m_cit it = mapVoteIndex.begin(); it != mapVoteIndex.end(); ++it) {
+        CGovernanceVoteStore::vote_ptr_t pvote = governanceVotes.Read(it->first);
+        if(pvote) {
+            vecResult.push_back(*pvote);
+        }
+    }
+    return vecResult;
+}
+
+std::vector<uint256> CGovernanceObjectVoteFile::GetVoteHashes() const
+{
+    std::vector<uint256> vecResult;
+    vecResult.reserve(mapVoteIndex.size());
+    for(vote_m_cit it = mapVoteIndex.begin(); it != mapVoteIndex.end(); ++it) {
+        vecResult.push_back(it->first);
     }
     return vecResult;
 }
 
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
-    vote_l_it it = listVotes.begin();
-    while(it != listVotes.end()) {
-        if(it->GetMasternodeOutpoint() == outpointMasternode) {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
+    vote_m_it it = mapVoteIndex.begin();
+    while(it != mapVoteIndex.end()) {
+        if(it->second == outpointMasternode) {
+            governanceVotes.Erase(it->first);
+            mapVoteIndex.erase(it++);
         }
         else {
             ++it;
@@ -68,21 +182,10 @@ void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpo
     }
 }
 
-void CGovernanceObjectVoteFile::RebuildIndex()
+void CGovernanceObjectVoteFile::RemoveAllVotes()
 {
-    mapVoteIndex.clear();
-    nMemoryVotes = 0;
-    vote_l_it it = listVotes.begin();
-    while(it != listVotes.end()) {
-        CGovernanceVote& vote = *it;
-        uint256 nHash = vote.GetHash();
-        if(mapVoteIndex.find(nHash) == mapVoteIndex.end()) {
-            mapVoteIndex[nHash] = it;
-            ++nMemoryVotes;
-            ++it;
-        }
-        else {
-            listVotes.erase(it++);
-        }
+    for(vote_m_cit it = mapVoteIndex.begin(); it != mapVoteIndex.end(); ++it) {
+        governanceVotes.Erase(it->first);
     }
+    mapVoteIndex.clear();
 }
@@ -5,44 +5,88 @@
 #ifndef GOVERNANCE_VOTEDB_H
 #define GOVERNANCE_VOTEDB_H
 
-#include <list>
+#include <functional>
 #include <map>
+#include <memory>
 
+#include <boost/filesystem/path.hpp>
+
+#include "cachemap.h"
 #include "governance-vote.h"
 #include "serialize.h"
 #include "streams.h"
+#include "sync.h"
 #include "uint256.h"
 
+class CDBWrapper;
+
+static const unsigned int DEFAULT_GOVERNANCE_VOTE_CACHE = 50000;
+static const size_t GOVERNANCE_VOTE_DB_CACHE = 8 << 20;
+
 /**
- * Represents the collection of votes associated with a given CGovernanceObject
- * Recently received votes are held in memory until a maximum size is reached after
- * which older votes a flushed to a disk file.
- *
- * Note: This is a stub implementation that doesn't limit the number of votes held
- * in memory and doesn't flush to disk.
+ * Holds the votes of all governance objects. Votes are written to a LevelDB
+ * database and the most recently used ones are also kept in a memory cache of
+ * bounded size. Until Init() is called votes are only held in memory and the
+ * cache isn't bounded.
  */
-class CGovernanceObjectVoteFile
+class CGovernanceVoteStore
 {
-public: // Types
-    typedef std::list<CGovernanceVote> vote_l_t;
+public:
+    typedef std::shared_ptr<const CGovernanceVote> vote_ptr_t;
 
-    typedef vote_l_t::iterator vote_l_it;
+private:
+    mutable CCriticalSection cs;
 
-    typedef vote_l_t::const_iterator vote_l_cit;
+    std::unique_ptr<CDBWrapper> db;
 
-    typedef std::map<uint256,vote_l_it> vote_m_t;
+    mutable CacheMap<uint256, vote_ptr_t> cacheVotes;
 
-    typedef vote_m_t::iterator vote_m_it;
+public:
+    CGovernanceVoteStore();
+    ~CGovernanceVoteStore();
 
-    typedef vote_m_t::const_iterator vote_m_cit;
+    /**
+     * Open the database and limit the memory cache to nCacheVotes votes
+     */
+    void Init(const boost::filesystem::path& path, size_t nDBCacheSize, unsigned int nCacheVotes, bool fMemory = false, bool fWipe = false);
 
-private:
-    static const int MAX_MEMORY_VOTES = -1;
+    /**
+     * Close the database, votes are only held in memory after this
+     */
+    void Close();
 
-    int nMemoryVotes;
+    void Write(const CGovernanceVote& vote);
 
-    vote_l_t listVotes;
+    /**
+     * Return the vote with this hash or nullptr if it isn't known
+     */
+    vote_ptr_t Read(const uint256& nHash) const;
+
+    void Erase(const uint256& nHash);
 
+    /**
+     * Erase all votes in the database for which fReferenced returns false
+     */
+    int EraseUnreferenced(const std::function<bool(const uint256& nHash, const CGovernanceVote& vote)>& fReferenced);
+};
+
+extern CGovernanceVoteStore governanceVotes;
+
+/**
+ * Represents the collection of votes associated with a given CGovernanceObject
+ * Only the vote hashes and the voting masternodes are held here, the votes
+ * themselves live in the CGovernanceVoteStore.
+ */
+class CGovernanceObjectVoteFile
+{
+public: // Types
+    typedef std::map<uint256, COutPoint> vote_m_t;
+
+    typedef vote_m_t::iterator vote_m_it;
+
+    typedef vote_m_t::const_iterator vote_m_cit;
+
+private:
     vote_m_t mapVoteIndex;
 
 public:
@@ -56,37 +100,39 @@ public:
     void AddVote(const CGovernanceVote& vote);
 
     /**
-     * Return true if the vote with this hash is currently cached in memory
+     * Return true if the vote with this hash is in the file
      */
     bool HasVote(const uint256& nHash) const;
 
     /**
-     * Retrieve a vote cached in memory
+     * Retrieve a vote from the vote store, nullptr if it isn't in the file
      */
+    CGovernanceVoteStore::vote_ptr_t GetVote(const uint256& nHash) const;
+
     bool SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const;
 
-    int GetVoteCount() {
-        return nMemoryVotes;
+    int GetVoteCount() const {
+        return (int)mapVoteIndex.size();
     }
 
     std::vector<CGovernanceVote> GetVotes() const;
 
+    std::vector<uint256> GetVoteHashes() const;
+
     void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
 
+    /**
+     * Remove all votes from the file and from the vote store
+     */
+    void RemoveAllVotes();
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action)
     {
-        READWRITE(nMemoryVotes);
-        READWRITE(listVotes);
-        if(ser_action.ForRead()) {
-            RebuildIndex();
-        }
+        READWRITE(mapVoteIndex);
     }
-private:
-    void RebuildIndex();
-
 };
 
 #endif
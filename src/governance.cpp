@@ -21,7 +21,7 @@ CGovernanceManager governance;
 
 int nSubmittedFinalBudget;
 
-const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-13";
+const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-14";
 const int CGovernanceManager::MAX_TIME_FUTURE_DEVIATION = 60*60;
 const int CGovernanceManager::RELIABLE_PROPAGATION_TIME = 60;
 
@@ -423,18 +423,8 @@ void CGovernanceManager::UpdateCachesAndClean()
             mnodeman.RemoveGovernanceObject(pObj->GetHash());
 
             // Remove vote references
-            const object_ref_cm_t::list_t& listItems = cmapVoteToObject.GetItemList();
-            object_ref_cm_t::list_cit lit = listItems.begin();
-            while(lit != listItems.end()) {
-                if(lit->value == pObj) {
-                    uint256 nKey = lit->key;
-                    ++lit;
-                    cmapVoteToObject.Erase(nKey);
-                }
-                else {
-                    ++lit;
-                }
-            }
+            cmapVoteToObject.EraseValue(pObj);
+            pObj->fileVotes.RemoveAllVotes();
 
             int64_t nTimeExpired{0};
 
@@ -683,11 +673,15 @@ void CGovernanceManager::SyncSingleObjAndItsVotes(CNode* pnode, const uint256& n
     LogPrint("gobject", "CGovernanceManager::%s -- syncing govobj: %s, peer=%d\n", __func__, strHash, pnode->id);
     pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, it->first));
 
-    auto fileVotes = govobj.GetVoteFile();
+    const CGovernanceObjectVoteFile& fileVotes = govobj.GetVoteFile();
 
-    for (const auto& vote : fileVotes.GetVotes()) {
-        uint256 nVoteHash = vote.GetHash();
-        if(filter.contains(nVoteHash) || !vote.IsValid(true)) {
+    // Votes are read from the vote store one by one, only those not in the filter
+    for (const auto& nVoteHash : fileVotes.GetVoteHashes()) {
+        if(filter.contains(nVoteHash)) {
+            continue;
+        }
+        CGovernanceVoteStore::vote_ptr_t pvote = fileVotes.GetVote(nVoteHash);
+        if(!pvote || !pvote->IsValid(true)) {
             continue;
         }
         pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, nVoteHash));
@@ -1037,10 +1031,10 @@ void CGovernanceManager::RequestGovernanceObject(CNode* pfrom, const uint256& nH
 
         if(pObj) {
             filter = CBloomFilter(Params().GetConsensus().nGovernanceFilterElements, GOVERNANCE_FILTER_FP_RATE, GetRandInt(999999), BLOOM_UPDATE_ALL);
-            std::vector<CGovernanceVote> vecVotes = pObj->GetVoteFile().GetVotes();
-            nVoteCount = vecVotes.size();
-            for(size_t i = 0; i < vecVotes.size(); ++i) {
-                filter.insert(vecVotes[i].GetHash());
+            std::vector<uint256> vecVoteHashes = pObj->GetVoteFile().GetVoteHashes();
+            nVoteCount = vecVoteHashes.size();
+            for(size_t i = 0; i < vecVoteHashes.size(); ++i) {
+                filter.insert(vecVoteHashes[i]);
             }
         }
     }
@@ -1190,9 +1184,9 @@ void CGovernanceManager::RebuildIndexes()
     cmapVoteToObject.Clear();
     for(object_m_it it = mapObjects.begin(); it != mapObjects.end(); ++it) {
         CGovernanceObject& govobj = it->second;
-        std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-        for(size_t i = 0; i < vecVotes.size(); ++i) {
-            cmapVoteToObject.Insert(vecVotes[i].GetHash(), &govobj);
+        std::vector<uint256> vecVoteHashes = govobj.GetVoteFile().GetVoteHashes();
+        for(size_t i = 0; i < vecVoteHashes.size(); ++i) {
+            cmapVoteToObject.Insert(vecVoteHashes[i], &govobj);
         }
     }
 }
@@ -1224,7 +1218,12 @@ void CGovernanceManager::InitOnLoad()
     LogPrintf("Preparing masternode indexes and governance triggers...\n");
     RebuildIndexes();
     AddCachedTriggers();
-    LogPrintf("Masternode indexes and governance triggers prepared  %dms\n", GetTimeMillis() - nStart);
+    // drop votes of objects which are gone, e.g. after governance.dat could not be loaded
+    int nErased = governanceVotes.EraseUnreferenced([this](const uint256& nHash, const CGovernanceVote& vote) {
+        object_m_cit it = mapObjects.find(vote.GetParentHash());
+        return it != mapObjects.end() && it->second.GetVoteFile().HasVote(nHash);
+    });
+    LogPrintf("Masternode indexes and governance triggers prepared, %d unreferenced votes erased  %dms\n", nErased, GetTimeMillis() - nStart);
     LogPrintf("     %s\n", ToString());
 }
 
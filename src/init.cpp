@@ -49,6 +49,7 @@
 #include "dsnotificationinterface.h"
 #include "flat-database.h"
 #include "governance.h"
+#include "governance-votedb.h"
 #include "instantx.h"
 #ifdef ENABLE_WALLET
 #include "keepass.h"
@@ -98,6 +99,8 @@ static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
 static const bool DEFAULT_DISABLE_SAFEMODE = false;
 static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
+/** Seconds between snapshots of the masternode, payment, governance and fulfilled request caches */
+static const int64_t DUMP_FLATDB_INTERVAL = 15 * 60;
 
 
 std::unique_ptr<CConnman> g_connman;
@@ -215,6 +218,19 @@ void Interrupt(boost::thread_group& threadGroup)
     threadGroup.interrupt_all();
 }
 
+/** Store the data caches into serialized dat files, also done periodically while running */
+static void DumpFlatDBCaches()
+{
+    CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
+    flatdb1.Dump(mnodeman);
+    CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
+    flatdb2.Dump(mnpayments);
+    CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
+    flatdb3.Dump(governance);
+    CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
+    flatdb4.Dump(netfulfilledman);
+}
+
 /** Preparing steps before shutting down or restarting the wallet */
 void PrepareShutdown()
 {
@@ -238,7 +254,7 @@ void PrepareShutdown()
     if (pwalletMain)
         pwalletMain->Flush(false);
 #endif
-    GenerateBitcoins(false, 0, Params(), *g_connman); // shutdown setgenerate miner
+    GenerateBitcoins(false, 0, -1, Params(), *g_connman); // shutdown setgenerate miners
     MapPort(false);
     UnregisterValidationInterface(peerLogic.get());
     peerLogic.reset();
@@ -246,14 +262,8 @@ void PrepareShutdown()
 
     // STORE DATA CACHES INTO SERIALIZED DAT FILES
     if (!fLiteMode) {
-        CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
-        flatdb1.Dump(mnodeman);
-        CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
-        flatdb2.Dump(mnpayments);
-        CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
-        flatdb3.Dump(governance);
-        CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
-        flatdb4.Dump(netfulfilledman);
+        DumpFlatDBCaches();
+        governanceVotes.Close();
     }
 
     UnregisterNodeSignals(GetNodeSignals());
@@ -420,6 +430,8 @@ std::string HelpMessage(HelpMessageMode mode)
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
+    strUsage += HelpMessageOpt("-powthreads=<n>", strprintf(_("Set the number of proof-of-work verification threads used for header sync and block index loading (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        -GetNumCores(), MAX_POWCHECK_THREADS, DEFAULT_POWCHECK_THREADS));
     strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >%u = automatically prune block files to stay under the specified target size in MiB)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
@@ -460,6 +472,11 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), DEFAULT_PROXYRANDOMIZE));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+#ifdef USE_EPOLL
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: %s (default: %s)"), "select, epoll", DEFAULT_SOCKETEVENTS));
+#else
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: %s (default: %s)"), "select", DEFAULT_SOCKETEVENTS));
+#endif
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
@@ -501,6 +518,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
+        strUsage += HelpMessageOpt("-checkpowonload=<mode>", strprintf("How to check the proof of work of the block index at startup: 0 = check stored PoW hashes against the target only, 1 = recompute every PoW hash, sampled = recompute one in %u (default: %s)", POW_LOAD_CHECK_SAMPLE_RATE, DEFAULT_CHECKPOWONLOAD));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", DEFAULT_DISABLE_SAFEMODE));
         strUsage += HelpMessageOpt("-testsafemode", strprintf("Force safe mode (default: %u)", DEFAULT_TESTSAFEMODE));
@@ -532,6 +550,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", DEFAULT_LIMITFREERELAY));
         strUsage += HelpMessageOpt("-relaypriority", strprintf("Require high priority for relaying free or low-fee transactions (default: %u)", DEFAULT_RELAYPRIORITY));
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxmsgsigcachesize=<n>", strprintf("Limit size of masternode message signature cache to <n> MiB (default: %u)", DEFAULT_MAX_MSG_SIG_CACHE_SIZE));
         strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for relaying, mining and transaction creation (default: %s)"),
@@ -554,6 +573,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-mnconf=<file>", strprintf(_("Specify masternode configuration file (default: %s)"), "masternode.conf"));
     strUsage += HelpMessageOpt("-mnconflock=<n>", strprintf(_("Lock masternodes from masternode configuration file (default: %u)"), 1));
     strUsage += HelpMessageOpt("-masternodeprivkey=<n>", _("Set the masternode private key"));
+    strUsage += HelpMessageOpt("-govvotecache=<n>", strprintf(_("Keep at most <n> governance votes in memory, the rest is read from disk when needed (default: %u)"), DEFAULT_GOVERNANCE_VOTE_CACHE));
 
 #ifdef ENABLE_WALLET
     strUsage += HelpMessageGroup(_("PrivateSend options:"));
@@ -952,6 +972,7 @@ ServiceFlags nRelevantServices = NODE_NETWORK;
 int nMaxConnections;
 int nUserMaxConnections;
 int nFD;
+CConnman::SocketEventsMode socketEventsMode = CConnman::SOCKETEVENTS_SELECT;
 ServiceFlags nLocalServices = NODE_NETWORK;
 
 }
@@ -1054,15 +1075,7 @@ bool AppInitParameterInteraction()
     fAllowPrivateNet = GetBoolArg("-allowprivatenet", DEFAULT_ALLOWPRIVATENET);
 
     // determine algorithm to be used for any mining for this instance
-    std::string strAlgo = GetArg("-algo", "neoscrypt");
-    transform(strAlgo.begin(),strAlgo.end(),strAlgo.begin(),::tolower);
-    if (strAlgo == "neoscrypt")
-        miningAlgo = ALGO_SLOT1;
-    else if (strAlgo == "argon2d" || strAlgo == "argon" || strAlgo == "argon2")
-        miningAlgo = ALGO_SLOT2;
-    else if (strAlgo == "lyra2cz" || strAlgo == "lyra2" || strAlgo == "Lyra2CZ")
-        miningAlgo = ALGO_SLOT3;
-    else
+    if (!GetAlgoByName(GetArg("-algo", "neoscrypt"), miningAlgo))
         miningAlgo = ALGO_SLOT1;
 
 
@@ -1073,8 +1086,21 @@ bool AppInitParameterInteraction()
     nUserMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
-    // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
+    std::string strSocketEventsMode = GetArg("-socketevents", DEFAULT_SOCKETEVENTS);
+    if (strSocketEventsMode == "select") {
+        socketEventsMode = CConnman::SOCKETEVENTS_SELECT;
+#ifdef USE_EPOLL
+    } else if (strSocketEventsMode == "epoll") {
+        socketEventsMode = CConnman::SOCKETEVENTS_EPOLL;
+#endif
+    } else {
+        return InitError(strprintf(_("Invalid -socketevents ('%s') specified."), strSocketEventsMode));
+    }
+
+    // Trim requested connection counts, to fit into system limitations.
+    // Only select() can't handle descriptors at or above FD_SETSIZE.
+    if (socketEventsMode == CConnman::SOCKETEVENTS_SELECT)
+        nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
     nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1119,6 +1145,8 @@ bool AppInitParameterInteraction()
     }
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    if (!ParsePoWLoadCheck(GetArg("-checkpowonload", DEFAULT_CHECKPOWONLOAD), nPoWLoadCheck))
+        return InitError(strprintf(_("Invalid -checkpowonload mode '%s'"), GetArg("-checkpowonload", DEFAULT_CHECKPOWONLOAD)));
 
     hashAssumeValid = uint256S(GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
     if (!hashAssumeValid.IsNull())
@@ -1150,6 +1178,15 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // -powthreads=0 means autodetect, but nPoWCheckThreads==0 means no concurrency
+    nPoWCheckThreads = GetArg("-powthreads", DEFAULT_POWCHECK_THREADS);
+    if (nPoWCheckThreads <= 0)
+        nPoWCheckThreads += GetNumCores();
+    if (nPoWCheckThreads <= 1)
+        nPoWCheckThreads = 0;
+    else if (nPoWCheckThreads > MAX_POWCHECK_THREADS)
+        nPoWCheckThreads = MAX_POWCHECK_THREADS;
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1357,11 +1394,20 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Using at most %i automatic connections (%i file descriptors available)\n", nMaxConnections, nFD);
 
     InitSignatureCache();
+    InitMessageSignatureCache();
 
-    LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
+    LogPrintf("Using %u threads for script and payment vote verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadPaymentVoteCheck);
+    }
+
+    LogPrintf("Using %u threads for PoW verification\n", nPoWCheckThreads);
+    if (nPoWCheckThreads) {
+        for (int i=0; i<nPoWCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadPoWCheck);
     }
 
     // disable this to be able to create spork address
@@ -1900,6 +1946,14 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         boost::filesystem::path pathDB = GetDataDir();
         std::string strDBName;
 
+        // governance votes are kept on disk, governance.dat only refers to them
+        uiInterface.InitMessage(_("Opening governance vote database..."));
+        try {
+            governanceVotes.Init(pathDB / "govvotes", GOVERNANCE_VOTE_DB_CACHE, std::max(GetArg("-govvotecache", DEFAULT_GOVERNANCE_VOTE_CACHE), (int64_t)1));
+        } catch (const dbwrapper_error& e) {
+            return InitError(_("Error opening governance vote database") + "\n" + e.what());
+        }
+
         strDBName = "mncache.dat";
         uiInterface.InitMessage(_("Loading masternode cache..."));
         CFlatDB<CMasternodeMan> flatdb1(strDBName, "magicMasternodeCache");
@@ -1932,6 +1986,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         if(!flatdb4.Load(netfulfilledman)) {
             return InitError(_("Failed to load fulfilled requests cache from") + "\n" + (pathDB / strDBName).string());
         }
+
+        // snapshot the caches now and then, only what changed since the last snapshot is written
+        scheduler.scheduleEvery(&DumpFlatDBCaches, DUMP_FLATDB_INTERVAL);
     }
 
 
@@ -1945,6 +2002,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     // ********************************************************* Step 11d: start kepler-ps-<smth> threads
 
     threadGroup.create_thread(boost::bind(&ThreadCheckPrivateSend, boost::ref(*g_connman)));
+    threadGroup.create_thread(boost::bind(&ThreadInstantSend, boost::ref(*g_connman)));
     if (fMasternodeMode)
         threadGroup.create_thread(boost::bind(&ThreadCheckPrivateSendServer, boost::ref(*g_connman)));
 #ifdef ENABLE_WALLET
@@ -1977,6 +2035,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     connOptions.uiInterface = &uiInterface;
     connOptions.nSendBufferMaxSize = 1000*GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000*GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
+    connOptions.socketEventsMode = socketEventsMode;
 
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
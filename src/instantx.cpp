@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "activemasternode.h"
+#include "init.h"
 #include "instantx.h"
 #include "key.h"
 #include "validation.h"
@@ -38,6 +39,16 @@ int nCompleteTXLocks;
 
 CInstantSend instantsend;
 
+// Add a tx hash to the sorted tx hashes voted for an outpoint, there is
+// hardly ever more than one so a flat vector is much smaller than a set
+static void InsertVotedTxHash(std::vector<uint256>& vecTxHashes, const uint256& txHash)
+{
+    std::vector<uint256>::iterator it = std::lower_bound(vecTxHashes.begin(), vecTxHashes.end(), txHash);
+    if(it == vecTxHashes.end() || *it != txHash) {
+        vecTxHashes.insert(it, txHash);
+    }
+}
+
 // Transaction Locks
 //
 // step 1) Some node announces intention to lock transaction inputs via "txlockrequest" message (ix)
@@ -82,7 +93,13 @@ void CInstantSend::ProcessMessage(CNode* pfrom, const std::string& strCommand, C
             if (!ret.second) return;
         }
 
-        ProcessNewTxLockVote(pfrom, vote, connman);
+        {
+            // checked and applied by the InstantSend thread, see ProcessPendingVotes
+            std::unique_lock<std::mutex> lock(mutexPendingVotes);
+            vecPendingVotes.push_back(CPendingTxLockVote(vote, pfrom->id, GetTimeMicros()));
+            voteQueueStats.nMaxQueued = std::max(voteQueueStats.nMaxQueued, vecPendingVotes.size());
+        }
+        condPendingVotes.notify_one();
 
         return;
     }
@@ -111,7 +128,7 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
     // Check to see if there are votes for conflicting request,
     // if so - do not fail, just warn user
     for (const auto& txin : txLockRequest.tx->vin) {
-        std::map<COutPoint, std::set<uint256> >::iterator it = mapVotedOutpoints.find(txin.prevout);
+        std::map<COutPoint, std::vector<uint256> >::iterator it = mapVotedOutpoints.find(txin.prevout);
         if(it != mapVotedOutpoints.end()) {
             for (const auto& hash : it->second) {
                 if(hash != txLockRequest.GetHash()) {
@@ -133,7 +150,7 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
     // Masternodes will sometimes propagate votes before the transaction is known to the client.
     // If this just happened - process orphan votes, lock inputs, resolve conflicting locks,
     // update transaction status forcing external script/zmq notifications.
-    ProcessOrphanTxLockVotes();
+    ProcessOrphanTxLockVotes(txHash);
     std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     TryToFinalizeLockCandidate(itLockCandidate->second);
 
@@ -250,7 +267,7 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate, CConnman& connman)
 
         LogPrint("instantsend", "CInstantSend::Vote -- In the top %d (%d)\n", nSignaturesTotal, nRank);
 
-        std::map<COutPoint, std::set<uint256> >::iterator itVoted = mapVotedOutpoints.find(itOutpointLock->first);
+        std::map<COutPoint, std::vector<uint256> >::iterator itVoted = mapVotedOutpoints.find(itOutpointLock->first);
 
         // Check to see if we already voted for this outpoint,
         // refuse to vote twice or to include the same outpoint in another tx
@@ -293,12 +310,10 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate, CConnman& connman)
                     txHash.ToString(), itOutpointLock->first.ToStringShort(), nVoteHash.ToString());
 
             if(itVoted == mapVotedOutpoints.end()) {
-                std::set<uint256> setHashes;
-                setHashes.insert(txHash);
-                mapVotedOutpoints.insert(std::make_pair(itOutpointLock->first, setHashes));
+                mapVotedOutpoints.emplace(itOutpointLock->first, std::vector<uint256>({txHash}));
             } else {
-                mapVotedOutpoints[itOutpointLock->first].insert(txHash);
-                if(mapVotedOutpoints[itOutpointLock->first].size() > 1) {
+                InsertVotedTxHash(itVoted->second, txHash);
+                if(itVoted->second.size() > 1) {
                     // it's ok to continue, just warn user
                     LogPrintf("CInstantSend::Vote -- WARNING: Vote conflicts with some existing votes: txHash=%s, outpoint=%s, vote=%s\n",
                             txHash.ToString(), itOutpointLock->first.ToStringShort(), nVoteHash.ToString());
@@ -312,25 +327,110 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate, CConnman& connman)
     }
 }
 
-bool CInstantSend::ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, CConnman& connman)
+bool CInstantSend::WaitForPendingVotes(int64_t nMilliseconds)
 {
-    uint256 txHash = vote.GetTxHash();
-    uint256 nVoteHash = vote.GetHash();
+    std::unique_lock<std::mutex> lock(mutexPendingVotes);
+    return condPendingVotes.wait_for(lock, std::chrono::milliseconds(nMilliseconds), [this] { return !vecPendingVotes.empty(); });
+}
 
-    if(!vote.IsValid(pfrom, connman)) {
-        // could be because of missing MN
-        LogPrint("instantsend", "CInstantSend::%s -- Vote is invalid, txid=%s\n", __func__, txHash.ToString());
-        return false;
+void CInstantSend::ProcessPendingVotes(CConnman& connman)
+{
+    std::vector<CPendingTxLockVote> vecVotes;
+    {
+        std::unique_lock<std::mutex> lock(mutexPendingVotes);
+        vecVotes.swap(vecPendingVotes);
+    }
+    if(vecVotes.empty()) return;
+
+    int64_t nTimeStart = GetTimeMicros();
+    int64_t nTotalLatency = 0;
+    int64_t nMaxLatency = 0;
+
+    // Signature, UTXO and rank checks only take cs_main briefly on their own,
+    // cs_instantsend can't be held here as it's always taken after cs_main
+    std::vector<CTxLockVote> vecValidVotes;
+    for (const auto& pendingVote : vecVotes) {
+        int64_t nLatency = nTimeStart - pendingVote.nTimeQueued;
+        nTotalLatency += nLatency;
+        nMaxLatency = std::max(nMaxLatency, nLatency);
+
+        const CTxLockVote& vote = pendingVote.vote;
+        if(!vote.IsValid(NULL, connman)) {
+            // could be because of missing MN
+            LogPrint("instantsend", "CInstantSend::%s -- Vote is invalid, txid=%s\n", __func__, vote.GetTxHash().ToString());
+            if(!mnodeman.Has(vote.GetMasternodeOutpoint())) {
+                connman.ForNode(pendingVote.nodeId, [&](CNode* pnode) {
+                    mnodeman.AskForMN(pnode, vote.GetMasternodeOutpoint(), connman);
+                    return true;
+                });
+            }
+            continue;
+        }
+        // relay valid vote asap
+        vote.Relay(connman);
+        vecValidVotes.push_back(vote);
     }
 
-    // relay valid vote asap
-    vote.Relay(connman);
+    std::vector<uint256> vecReadyTxHashes;
+    {
+        LOCK(cs_instantsend);
+        std::set<uint256> setTxHashes;
+        for (const auto& vote : vecValidVotes) {
+            if(ProcessNewTxLockVote(vote)) {
+                setTxHashes.insert(vote.GetTxHash());
+            }
+        }
+        for (const auto& txHash : setTxHashes) {
+            std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+            if(it != mapTxLockCandidates.end() && it->second.txLockRequest &&
+                    it->second.IsAllOutPointsReady() && !IsLockedInstantSendTransaction(txHash)) {
+                vecReadyTxHashes.push_back(txHash);
+            }
+        }
+    }
 
-    LOCK(cs_main);
+    if(!vecReadyTxHashes.empty()) {
+        LOCK(cs_main);
 #ifdef ENABLE_WALLET
-    LOCK(pwalletMain ? &pwalletMain->cs_wallet : NULL);
+        LOCK(pwalletMain ? &pwalletMain->cs_wallet : NULL);
 #endif
-    LOCK2(mempool.cs, cs_instantsend);
+        LOCK2(mempool.cs, cs_instantsend);
+        for (const auto& txHash : vecReadyTxHashes) {
+            // candidates can be removed while resolving conflicts of the previous ones
+            std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+            if(it != mapTxLockCandidates.end()) {
+                TryToFinalizeLockCandidate(it->second);
+            }
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutexPendingVotes);
+        voteQueueStats.nTotalLatency += nTotalLatency;
+        voteQueueStats.nProcessed += vecVotes.size();
+        voteQueueStats.nBatches++;
+        if(!vecReadyTxHashes.empty()) voteQueueStats.nFinalizeBatches++;
+        voteQueueStats.nMaxLatency = std::max(voteQueueStats.nMaxLatency, nMaxLatency);
+    }
+
+    LogPrint("instantsend", "CInstantSend::%s -- processed %d votes, %d valid, %d locks to finalize in %dus, max latency %dus\n", __func__,
+            vecVotes.size(), vecValidVotes.size(), vecReadyTxHashes.size(), GetTimeMicros() - nTimeStart, nMaxLatency);
+}
+
+CTxLockVoteQueueStats CInstantSend::GetVoteQueueStats()
+{
+    std::unique_lock<std::mutex> lock(mutexPendingVotes);
+    CTxLockVoteQueueStats stats = voteQueueStats;
+    stats.nQueued = vecPendingVotes.size();
+    return stats;
+}
+
+bool CInstantSend::ProcessNewTxLockVote(const CTxLockVote& vote)
+{
+    AssertLockHeld(cs_instantsend);
+
+    uint256 txHash = vote.GetTxHash();
+    uint256 nVoteHash = vote.GetHash();
 
     // Masternodes will sometimes propagate votes before the transaction is known to the client,
     // will actually process only after the lock request itself has arrived
@@ -342,7 +442,7 @@ bool CInstantSend::ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, C
             // start timeout countdown after the very first vote
             CreateEmptyTxLockCandidate(txHash);
         }
-        bool fInserted = mapTxLockVotesOrphan.emplace(nVoteHash, vote).second;
+        bool fInserted = AddOrphanTxLockVote(nVoteHash, vote);
         LogPrint("instantsend", "CInstantSend::%s -- Orphan vote: txid=%s  masternode=%s %s\n",
                 __func__, txHash.ToString(), vote.GetMasternodeOutpoint().ToStringShort(), fInserted ? "new" : "seen");
 
@@ -353,6 +453,7 @@ bool CInstantSend::ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, C
         auto itMnOV = mapMasternodeOrphanVotes.find(vote.GetMasternodeOutpoint());
         if(itMnOV == mapMasternodeOrphanVotes.end()) {
             mapMasternodeOrphanVotes.emplace(vote.GetMasternodeOutpoint(), nMasternodeOrphanExpireTime);
+            nMasternodeOrphanVoteTimeTotal += nMasternodeOrphanExpireTime;
         } else {
             if(itMnOV->second > GetTime() && itMnOV->second > GetAverageMasternodeOrphanVoteTime()) {
                 LogPrint("instantsend", "CInstantSend::%s -- masternode is spamming orphan Transaction Lock Votes: txid=%s  masternode=%s\n",
@@ -361,6 +462,7 @@ bool CInstantSend::ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, C
                 return false;
             }
             // not spamming, refresh
+            nMasternodeOrphanVoteTimeTotal += nMasternodeOrphanExpireTime - itMnOV->second;
             itMnOV->second = nMasternodeOrphanExpireTime;
         }
 
@@ -389,8 +491,6 @@ bool CInstantSend::ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, C
     LogPrint("instantsend", "CInstantSend::%s -- Transaction Lock signatures count: %d/%d, vote hash=%s\n", __func__,
             nSignatures, nSignaturesMax, nVoteHash.ToString());
 
-    TryToFinalizeLockCandidate(txLockCandidate);
-
     return true;
 }
 
@@ -441,7 +541,7 @@ void CInstantSend::UpdateVotedOutpoints(const CTxLockVote& vote, CTxLockCandidat
 
     uint256 txHash = vote.GetTxHash();
 
-    std::map<COutPoint, std::set<uint256> >::iterator it1 = mapVotedOutpoints.find(vote.GetOutpoint());
+    std::map<COutPoint, std::vector<uint256> >::iterator it1 = mapVotedOutpoints.find(vote.GetOutpoint());
     if(it1 != mapVotedOutpoints.end()) {
         for (const auto& hash : it1->second) {
             if(hash != txHash) {
@@ -466,23 +566,55 @@ void CInstantSend::UpdateVotedOutpoints(const CTxLockVote& vote, CTxLockCandidat
             }
         }
         // store all votes, regardless of them being sent by malicious masternode or not
-        it1->second.insert(txHash);
+        InsertVotedTxHash(it1->second, txHash);
     } else {
-        mapVotedOutpoints.emplace(vote.GetOutpoint(), std::set<uint256>({txHash}));
+        mapVotedOutpoints.emplace(vote.GetOutpoint(), std::vector<uint256>({txHash}));
     }
 }
 
-void CInstantSend::ProcessOrphanTxLockVotes()
+bool CInstantSend::AddOrphanTxLockVote(const uint256& nVoteHash, const CTxLockVote& vote)
+{
+    AssertLockHeld(cs_instantsend);
+
+    if(!mapTxLockVotesOrphan.emplace(nVoteHash, vote).second) return false;
+
+    mapTxLockVotesOrphanByTx[vote.GetTxHash()].insert(nVoteHash);
+    setTxLockVotesOrphanByTime.emplace(vote.GetTimeCreated(), nVoteHash);
+    return true;
+}
+
+void CInstantSend::EraseOrphanTxLockVote(std::map<uint256, CTxLockVote>::iterator itOrphanVote)
+{
+    AssertLockHeld(cs_instantsend);
+
+    const uint256& nVoteHash = itOrphanVote->first;
+    const CTxLockVote& vote = itOrphanVote->second;
+
+    auto itByTx = mapTxLockVotesOrphanByTx.find(vote.GetTxHash());
+    if(itByTx != mapTxLockVotesOrphanByTx.end()) {
+        itByTx->second.erase(nVoteHash);
+        if(itByTx->second.empty()) {
+            mapTxLockVotesOrphanByTx.erase(itByTx);
+        }
+    }
+    setTxLockVotesOrphanByTime.erase(std::make_pair(vote.GetTimeCreated(), nVoteHash));
+    mapTxLockVotesOrphan.erase(itOrphanVote);
+}
+
+void CInstantSend::ProcessOrphanTxLockVotes(const uint256& txHash)
 {
     AssertLockHeld(cs_main);
     AssertLockHeld(cs_instantsend);
 
-    std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotesOrphan.begin();
-    while(it != mapTxLockVotesOrphan.end()) {
-        if(ProcessOrphanTxLockVote(it->second)) {
-            mapTxLockVotesOrphan.erase(it++);
-        } else {
-            ++it;
+    auto itByTx = mapTxLockVotesOrphanByTx.find(txHash);
+    if(itByTx == mapTxLockVotesOrphanByTx.end()) return;
+
+    // copy, processed votes are removed from the index
+    std::set<uint256> setVoteHashes = itByTx->second;
+    for (const auto& nVoteHash : setVoteHashes) {
+        auto it = mapTxLockVotesOrphan.find(nVoteHash);
+        if(it != mapTxLockVotesOrphan.end() && ProcessOrphanTxLockVote(it->second)) {
+            EraseOrphanTxLockVote(it);
         }
     }
 }
@@ -647,15 +779,7 @@ int64_t CInstantSend::GetAverageMasternodeOrphanVoteTime()
     // NOTE: should never actually call this function when mapMasternodeOrphanVotes is empty
     if(mapMasternodeOrphanVotes.empty()) return 0;
 
-    std::map<COutPoint, int64_t>::iterator it = mapMasternodeOrphanVotes.begin();
-    int64_t total = 0;
-
-    while(it != mapMasternodeOrphanVotes.end()) {
-        total+= it->second;
-        ++it;
-    }
-
-    return total / mapMasternodeOrphanVotes.size();
+    return nMasternodeOrphanVoteTimeTotal / (int64_t)mapMasternodeOrphanVotes.size();
 }
 
 void CInstantSend::CheckAndRemove()
@@ -698,17 +822,19 @@ void CInstantSend::CheckAndRemove()
         }
     }
 
-    // remove timed out orphan votes
-    std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.begin();
-    while(itOrphanVote != mapTxLockVotesOrphan.end()) {
-        if(itOrphanVote->second.IsTimedOut()) {
-            LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing timed out orphan vote: txid=%s  masternode=%s\n",
-                    itOrphanVote->second.GetTxHash().ToString(), itOrphanVote->second.GetMasternodeOutpoint().ToStringShort());
-            mapTxLockVotes.erase(itOrphanVote->first);
-            mapTxLockVotesOrphan.erase(itOrphanVote++);
-        } else {
-            ++itOrphanVote;
+    // remove timed out orphan votes, oldest first
+    while(!setTxLockVotesOrphanByTime.empty()) {
+        std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.find(setTxLockVotesOrphanByTime.begin()->second);
+        if(itOrphanVote == mapTxLockVotesOrphan.end()) {
+            // should never happen
+            setTxLockVotesOrphanByTime.erase(setTxLockVotesOrphanByTime.begin());
+            continue;
         }
+        if(!itOrphanVote->second.IsTimedOut()) break;
+        LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing timed out orphan vote: txid=%s  masternode=%s\n",
+                itOrphanVote->second.GetTxHash().ToString(), itOrphanVote->second.GetMasternodeOutpoint().ToStringShort());
+        mapTxLockVotes.erase(itOrphanVote->first);
+        EraseOrphanTxLockVote(itOrphanVote);
     }
 
     // remove invalid votes and votes for failed lock attempts
@@ -729,6 +855,7 @@ void CInstantSend::CheckAndRemove()
         if(itMasternodeOrphan->second < GetTime()) {
             LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing timed out orphan masternode vote: masternode=%s\n",
                     itMasternodeOrphan->first.ToStringShort());
+            nMasternodeOrphanVoteTimeTotal -= itMasternodeOrphan->second;
             mapMasternodeOrphanVotes.erase(itMasternodeOrphan++);
         } else {
             ++itMasternodeOrphan;
@@ -899,39 +1026,50 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlockIndex *pi
         std::map<COutPoint, COutPointLock>::iterator itOutpointLock = itLockCandidate->second.mapOutPointLocks.begin();
         while(itOutpointLock != itLockCandidate->second.mapOutPointLocks.end()) {
             // Check corresponding lock votes
-            std::vector<CTxLockVote> vVotes = itOutpointLock->second.GetVotes();
-            std::vector<CTxLockVote>::iterator itVote = vVotes.begin();
             std::map<uint256, CTxLockVote>::iterator it;
-            while(itVote != vVotes.end()) {
-                uint256 nVoteHash = itVote->GetHash();
+            for (const auto& pair : itOutpointLock->second.GetMasternodeVotes()) {
+                const uint256& nVoteHash = pair.second;
                 LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d vote %s updated\n",
                         txHash.ToString(), nHeightNew, nVoteHash.ToString());
                 it = mapTxLockVotes.find(nVoteHash);
                 if(it != mapTxLockVotes.end()) {
                     it->second.SetConfirmedHeight(nHeightNew);
                 }
-                ++itVote;
             }
             ++itOutpointLock;
         }
     }
 
     // check orphan votes
-    std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.begin();
-    while(itOrphanVote != mapTxLockVotesOrphan.end()) {
-        if(itOrphanVote->second.GetTxHash() == txHash) {
+    std::map<uint256, std::set<uint256> >::iterator itOrphanByTx = mapTxLockVotesOrphanByTx.find(txHash);
+    if(itOrphanByTx != mapTxLockVotesOrphanByTx.end()) {
+        for (const auto& nVoteHash : itOrphanByTx->second) {
             LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d vote %s updated\n",
-                    txHash.ToString(), nHeightNew, itOrphanVote->first.ToString());
-            mapTxLockVotes[itOrphanVote->first].SetConfirmedHeight(nHeightNew);
+                    txHash.ToString(), nHeightNew, nVoteHash.ToString());
+            mapTxLockVotes[nVoteHash].SetConfirmedHeight(nHeightNew);
         }
-        ++itOrphanVote;
     }
 }
 
+size_t CInstantSend::DynamicMemoryUsage()
+{
+    LOCK(cs_instantsend);
+    return memusage::DynamicUsage(mapLockRequestAccepted) +
+           memusage::DynamicUsage(mapLockRequestRejected) +
+           memusage::RecursiveDynamicUsage(mapTxLockVotes) +
+           memusage::RecursiveDynamicUsage(mapTxLockVotesOrphan) +
+           memusage::RecursiveDynamicUsage(mapTxLockVotesOrphanByTx) +
+           memusage::DynamicUsage(setTxLockVotesOrphanByTime) +
+           memusage::RecursiveDynamicUsage(mapTxLockCandidates) +
+           memusage::RecursiveDynamicUsage(mapVotedOutpoints) +
+           memusage::DynamicUsage(mapLockedOutpoints) +
+           memusage::DynamicUsage(mapMasternodeOrphanVotes);
+}
+
 std::string CInstantSend::ToString()
 {
     LOCK(cs_instantsend);
-    return strprintf("Lock Candidates: %llu, Votes %llu", mapTxLockCandidates.size(), mapTxLockVotes.size());
+    return strprintf("Lock Candidates: %llu, Votes %llu, Memory usage %llu", mapTxLockCandidates.size(), mapTxLockVotes.size(), DynamicMemoryUsage());
 }
 
 //
@@ -1151,36 +1289,34 @@ bool CTxLockVote::IsFailed() const
 // COutPointLock
 //
 
-bool COutPointLock::AddVote(const CTxLockVote& vote)
+static bool CompareMasternodeOutpoint(const std::pair<COutPoint, uint256>& a, const COutPoint& b)
 {
-    if(mapMasternodeVotes.count(vote.GetMasternodeOutpoint()))
-        return false;
-    mapMasternodeVotes.insert(std::make_pair(vote.GetMasternodeOutpoint(), vote));
-    return true;
+    return a.first < b;
 }
 
-std::vector<CTxLockVote> COutPointLock::GetVotes() const
+bool COutPointLock::AddVote(const CTxLockVote& vote)
 {
-    std::vector<CTxLockVote> vRet;
-    std::map<COutPoint, CTxLockVote>::const_iterator itVote = mapMasternodeVotes.begin();
-    while(itVote != mapMasternodeVotes.end()) {
-        vRet.push_back(itVote->second);
-        ++itVote;
-    }
-    return vRet;
+    COutPoint outpointMasternode = vote.GetMasternodeOutpoint();
+    std::vector<std::pair<COutPoint, uint256> >::iterator it =
+            std::lower_bound(vecMasternodeVotes.begin(), vecMasternodeVotes.end(), outpointMasternode, CompareMasternodeOutpoint);
+    if(it != vecMasternodeVotes.end() && it->first == outpointMasternode)
+        return false;
+    vecMasternodeVotes.insert(it, std::make_pair(outpointMasternode, vote.GetHash()));
+    return true;
 }
 
 bool COutPointLock::HasMasternodeVoted(const COutPoint& outpointMasternodeIn) const
 {
-    return mapMasternodeVotes.count(outpointMasternodeIn);
+    std::vector<std::pair<COutPoint, uint256> >::const_iterator it =
+            std::lower_bound(vecMasternodeVotes.begin(), vecMasternodeVotes.end(), outpointMasternodeIn, CompareMasternodeOutpoint);
+    return it != vecMasternodeVotes.end() && it->first == outpointMasternodeIn;
 }
 
 void COutPointLock::Relay(CConnman& connman) const
 {
-    std::map<COutPoint, CTxLockVote>::const_iterator itVote = mapMasternodeVotes.begin();
-    while(itVote != mapMasternodeVotes.end()) {
-        itVote->second.Relay(connman);
-        ++itVote;
+    for (const auto& pair : vecMasternodeVotes) {
+        CInv inv(MSG_TXLOCK_VOTE, pair.second);
+        connman.RelayInv(inv);
     }
 }
 
@@ -1225,6 +1361,12 @@ bool CTxLockCandidate::HasMasternodeVoted(const COutPoint& outpointIn, const COu
     return it !=mapOutPointLocks.end() && it->second.HasMasternodeVoted(outpointMasternodeIn);
 }
 
+size_t CTxLockCandidate::DynamicMemoryUsage() const
+{
+    // the tx itself is shared with the mempool and lock requests, it's not counted here
+    return memusage::RecursiveDynamicUsage(mapOutPointLocks);
+}
+
 int CTxLockCandidate::CountVotes() const
 {
     // Note: do NOT use vote count to figure out if tx is locked, use IsAllOutPointsReady() instead
@@ -1257,3 +1399,25 @@ void CTxLockCandidate::Relay(CConnman& connman) const
         ++itOutpointLock;
     }
 }
+
+void ThreadInstantSend(CConnman& connman)
+{
+    if(fLiteMode) return; // disable all Kepler specific functionality
+
+    static bool fOneThread;
+    if(fOneThread) return;
+    fOneThread = true;
+
+    // Make this thread recognisable as the InstantSend thread
+    RenameThread("kepler-is");
+
+    while (true)
+    {
+        bool fHaveVotes = instantsend.WaitForPendingVotes(100);
+        boost::this_thread::interruption_point();
+
+        if(fHaveVotes && !ShutdownRequested()) {
+            instantsend.ProcessPendingVotes(connman);
+        }
+    }
+}
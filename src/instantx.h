@@ -5,6 +5,7 @@
 #define INSTANTX_H
 
 #include "chain.h"
+#include "memusage.h"
 #include "net.h"
 #include "primitives/transaction.h"
 
@@ -13,6 +14,7 @@ class COutPointLock;
 class CTxLockRequest;
 class CTxLockCandidate;
 class CInstantSend;
+struct CPendingTxLockVote;
 
 extern CInstantSend instantsend;
 
@@ -47,6 +49,20 @@ extern bool fEnableInstantSend;
 extern int nInstantSendDepth;
 extern int nCompleteTXLocks;
 
+/** Depth and latency (in microseconds) of the lock vote queue */
+struct CTxLockVoteQueueStats
+{
+    size_t nQueued;
+    size_t nMaxQueued;
+    uint64_t nProcessed;
+    uint64_t nBatches;
+    uint64_t nFinalizeBatches;
+    int64_t nTotalLatency;
+    int64_t nMaxLatency;
+
+    CTxLockVoteQueueStats() : nQueued(0), nMaxQueued(0), nProcessed(0), nBatches(0), nFinalizeBatches(0), nTotalLatency(0), nMaxLatency(0) {}
+};
+
 /**
  * Manages InstantSend. Processes lock requests, candidates, and votes.
  */
@@ -61,25 +77,38 @@ private:
     std::map<uint256, CTxLockRequest> mapLockRequestRejected; ///< Tx hash - Tx
     std::map<uint256, CTxLockVote> mapTxLockVotes; ///< Vote hash - Vote
     std::map<uint256, CTxLockVote> mapTxLockVotesOrphan; ///< Vote hash - Vote
+    std::map<uint256, std::set<uint256> > mapTxLockVotesOrphanByTx; ///< Tx hash - Orphan vote hash set
+    std::set<std::pair<int64_t, uint256> > setTxLockVotesOrphanByTime; ///< (Time created, Orphan vote hash)
 
     std::map<uint256, CTxLockCandidate> mapTxLockCandidates; ///< Tx hash - Lock candidate
 
-    std::map<COutPoint, std::set<uint256> > mapVotedOutpoints; ///< UTXO - Tx hash set
+    std::map<COutPoint, std::vector<uint256> > mapVotedOutpoints; ///< UTXO - Sorted tx hashes
     std::map<COutPoint, uint256> mapLockedOutpoints; ///< UTXO - Tx hash
 
     /// Track masternodes who voted with no txlockrequest (for DOS protection)
     std::map<COutPoint, int64_t> mapMasternodeOrphanVotes; ///< MN outpoint - Time
+    int64_t nMasternodeOrphanVoteTimeTotal = 0; ///< Sum of the times in mapMasternodeOrphanVotes
+
+    // Votes waiting for the InstantSend thread. Guarded by their own mutex only, so
+    // that queueing a vote never waits for cs_main or cs_instantsend.
+    std::mutex mutexPendingVotes;
+    std::condition_variable condPendingVotes;
+    std::vector<CPendingTxLockVote> vecPendingVotes;
+    CTxLockVoteQueueStats voteQueueStats;
 
     bool CreateTxLockCandidate(const CTxLockRequest& txLockRequest);
     void CreateEmptyTxLockCandidate(const uint256& txHash);
     void Vote(CTxLockCandidate& txLockCandidate, CConnman& connman);
 
-    /// Process consensus vote message
-    bool ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, CConnman& connman);
+    /// Process consensus vote message, the vote must be valid already
+    bool ProcessNewTxLockVote(const CTxLockVote& vote);
 
     void UpdateVotedOutpoints(const CTxLockVote& vote, CTxLockCandidate& txLockCandidate);
+    bool AddOrphanTxLockVote(const uint256& nVoteHash, const CTxLockVote& vote);
+    void EraseOrphanTxLockVote(std::map<uint256, CTxLockVote>::iterator itOrphanVote);
     bool ProcessOrphanTxLockVote(const CTxLockVote& vote);
-    void ProcessOrphanTxLockVotes();
+    /// Process orphan votes for a tx whose lock request has just arrived
+    void ProcessOrphanTxLockVotes(const uint256& txHash);
     int64_t GetAverageMasternodeOrphanVoteTime();
 
     void TryToFinalizeLockCandidate(const CTxLockCandidate& txLockCandidate);
@@ -96,6 +125,12 @@ public:
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
 
     bool ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CConnman& connman);
+    /// Wait up to nMilliseconds for votes to be queued, returns true if there are any
+    bool WaitForPendingVotes(int64_t nMilliseconds);
+    /// Check all queued votes without cs_main, then finalize the locks they completed
+    /// holding cs_main once for the whole batch
+    void ProcessPendingVotes(CConnman& connman);
+    CTxLockVoteQueueStats GetVoteQueueStats();
     void Vote(const uint256& txHash, CConnman& connman);
 
     bool AlreadyHave(const uint256& hash);
@@ -126,6 +161,9 @@ public:
     void UpdatedBlockTip(const CBlockIndex *pindex);
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock);
 
+    /// Heap memory used by lock candidates and votes
+    size_t DynamicMemoryUsage();
+
     std::string ToString();
 };
 
@@ -237,6 +275,7 @@ public:
     uint256 GetTxHash() const { return txHash; }
     COutPoint GetOutpoint() const { return outpoint; }
     COutPoint GetMasternodeOutpoint() const { return outpointMasternode; }
+    int64_t GetTimeCreated() const { return nTimeCreated; }
 
     bool IsValid(CNode* pnode, CConnman& connman) const;
     void SetConfirmedHeight(int nConfirmedHeightIn) { nConfirmedHeight = nConfirmedHeightIn; }
@@ -248,6 +287,22 @@ public:
     bool CheckSignature() const;
 
     void Relay(CConnman& connman) const;
+
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(vchMasternodeSignature); }
+};
+
+/** A lock vote waiting to be processed, with the peer it came from and when it was queued */
+struct CPendingTxLockVote
+{
+    CTxLockVote vote;
+    NodeId nodeId;
+    int64_t nTimeQueued;
+
+    CPendingTxLockVote(const CTxLockVote& voteIn, NodeId nodeIdIn, int64_t nTimeQueuedIn) :
+        vote(voteIn),
+        nodeId(nodeIdIn),
+        nTimeQueued(nTimeQueuedIn)
+        {}
 };
 
 /**
@@ -257,7 +312,9 @@ class COutPointLock
 {
 private:
     COutPoint outpoint; ///< UTXO
-    std::map<COutPoint, CTxLockVote> mapMasternodeVotes; ///< Masternode outpoint - vote
+    /// Masternode outpoint - Vote hash, sorted by masternode outpoint. Only SIGNATURES_TOTAL
+    /// masternodes can vote, the votes themselves are kept in CInstantSend::mapTxLockVotes.
+    std::vector<std::pair<COutPoint, uint256> > vecMasternodeVotes;
     bool fAttacked = false;
 
 public:
@@ -266,19 +323,21 @@ public:
 
     COutPointLock(const COutPoint& outpointIn) :
         outpoint(outpointIn),
-        mapMasternodeVotes()
+        vecMasternodeVotes()
         {}
 
     COutPoint GetOutpoint() const { return outpoint; }
 
     bool AddVote(const CTxLockVote& vote);
-    std::vector<CTxLockVote> GetVotes() const;
+    const std::vector<std::pair<COutPoint, uint256> >& GetMasternodeVotes() const { return vecMasternodeVotes; }
     bool HasMasternodeVoted(const COutPoint& outpointMasternodeIn) const;
-    int CountVotes() const { return fAttacked ? 0 : mapMasternodeVotes.size(); }
+    int CountVotes() const { return fAttacked ? 0 : vecMasternodeVotes.size(); }
     bool IsReady() const { return !fAttacked && CountVotes() >= SIGNATURES_REQUIRED; }
     void MarkAsAttacked() { fAttacked = true; }
 
     void Relay(CConnman& connman) const;
+
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(vecMasternodeVotes); }
 };
 
 /**
@@ -316,6 +375,10 @@ public:
     bool IsTimedOut() const;
 
     void Relay(CConnman& connman) const;
+
+    size_t DynamicMemoryUsage() const;
 };
 
+void ThreadInstantSend(CConnman& connman);
+
 #endif
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "activemasternode.h"
+#include "checkqueue.h"
 #include "consensus/validation.h"
 #include "governance-classes.h"
 #include "masternode-payments.h"
@@ -13,6 +14,7 @@
 #include "netmessagemaker.h"
 #include "spork.h"
 #include "util.h"
+#include "validation.h"
 
 #include <boost/lexical_cast.hpp>
 
@@ -219,9 +221,15 @@ std::string GetRequiredPaymentsString(int nBlockHeight)
 
 void CMasternodePayments::Clear()
 {
+    {
+        LOCK(cs_vecPendingVotes);
+        vecPendingVotes.clear();
+    }
     LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
     mapMasternodeBlocks.clear();
     mapMasternodePaymentVotes.clear();
+    mapPayeeVoteCounts.clear();
+    mapBestPayees.clear();
 }
 
 bool CMasternodePayments::UpdateLastVote(const CMasternodePaymentVote& vote)
@@ -383,28 +391,108 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, const std::string& strCom
             return;
         }
 
-        int nDos = 0;
-        if(!vote.CheckSignature(mnInfo.pubKeyMasternode, nCachedBlockHeight, nDos)) {
-            if(nDos) {
+        // Signatures are verified in batches on the vote check threads, queue
+        // this vote and flush the queue once it is big enough or this peer has
+        // nothing else for us right now (i.e. the burst of votes is over).
+        bool fFlush = AddPendingVote(CPendingPaymentVote(vote, pfrom->id, mnInfo.pubKeyMasternode, nCachedBlockHeight));
+        if(!fFlush) {
+            LOCK(pfrom->cs_vProcessMsg);
+            fFlush = pfrom->vProcessMsg.empty();
+        }
+        if(fFlush) {
+            ProcessPendingVotes(connman);
+        }
+    }
+}
+
+static CCheckQueue<CPaymentVoteCheck> paymentvotecheckqueue(16);
+
+void ThreadPaymentVoteCheck()
+{
+    RenameThread("kepler-mnwcheck");
+    paymentvotecheckqueue.Thread();
+}
+
+bool CPaymentVoteCheck::operator()()
+{
+    pPendingVote->fValid = pPendingVote->vote.CheckSignature(pPendingVote->pubKeyMasternode, pPendingVote->nValidationHeight, pPendingVote->nDos);
+    return true;
+}
+
+void CheckPaymentVoteSignatures(std::vector<CPendingPaymentVote>& vecVotes)
+{
+    std::vector<CPaymentVoteCheck> vChecks;
+    vChecks.reserve(vecVotes.size());
+    for (auto& pendingVote : vecVotes) {
+        if(!pendingVote.fValid) {
+            vChecks.push_back(CPaymentVoteCheck(&pendingVote));
+        }
+    }
+
+    if(nScriptCheckThreads && vChecks.size() > 1) {
+        CCheckQueueControl<CPaymentVoteCheck> control(&paymentvotecheckqueue);
+        control.Add(vChecks);
+        control.Wait();
+    } else {
+        for (auto& check : vChecks) {
+            check();
+        }
+    }
+}
+
+bool CMasternodePayments::AddPendingVote(const CPendingPaymentVote& pendingVote)
+{
+    LOCK(cs_vecPendingVotes);
+    vecPendingVotes.push_back(pendingVote);
+    return vecPendingVotes.size() >= MNPAYMENTS_VOTE_CHECK_BATCH_SIZE;
+}
+
+void CMasternodePayments::ProcessPendingVotes(CConnman& connman)
+{
+    // Batches must be applied in the order they were queued
+    LOCK(cs_ProcessPendingVotes);
+
+    std::vector<CPendingPaymentVote> vecVotes;
+    {
+        LOCK(cs_vecPendingVotes);
+        vecVotes.swap(vecPendingVotes);
+    }
+    if(vecVotes.empty()) return;
+
+    // signatures seen before are answered by the message signature cache
+    CheckPaymentVoteSignatures(vecVotes);
+
+    for (auto& pendingVote : vecVotes) {
+        const CMasternodePaymentVote& vote = pendingVote.vote;
+        uint256 nHash = vote.GetHash();
+
+        // the same vote could be queued more than once if several peers relayed it
+        if(HasVerifiedPaymentVote(nHash)) continue;
+
+        if(!pendingVote.fValid) {
+            if(pendingVote.nDos) {
                 LOCK(cs_main);
                 LogPrintf("MASTERNODEPAYMENTVOTE -- ERROR: invalid signature\n");
-                Misbehaving(pfrom->GetId(), nDos);
+                Misbehaving(pendingVote.nodeId, pendingVote.nDos);
             } else {
                 // only warn about anything non-critical (i.e. nDos == 0) in debug mode
                 LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- WARNING: invalid signature\n");
             }
             // Either our info or vote info could be outdated.
             // In case our info is outdated, ask for an update,
-            mnodeman.AskForMN(pfrom, vote.masternodeOutpoint, connman);
+            connman.ForNode(pendingVote.nodeId, [&](CNode* pnode) {
+                mnodeman.AskForMN(pnode, vote.masternodeOutpoint, connman);
+                return true;
+            });
             // but there is nothing we can do if vote info itself is outdated
             // (i.e. it was signed by a mn which changed its key),
-            // so just quit here.
-            return;
+            // so just skip it.
+            continue;
         }
 
         if(!UpdateLastVote(vote)) {
             LogPrintf("MASTERNODEPAYMENTVOTE -- masternode already voted, masternode=%s\n", vote.masternodeOutpoint.ToStringShort());
-            return;
+            continue;
         }
 
         CTxDestination address1;
@@ -476,8 +564,10 @@ bool CMasternodePayments::GetBlockPayee(int nBlockHeight, CScript& payeeRet) con
 {
     LOCK(cs_mapMasternodeBlocks);
 
-    auto it = mapMasternodeBlocks.find(nBlockHeight);
-    return it != mapMasternodeBlocks.end() && it->second.GetBestPayee(payeeRet);
+    auto it = mapBestPayees.find(nBlockHeight);
+    if(it == mapBestPayees.end()) return false;
+    payeeRet = it->second;
+    return true;
 }
 
 // Is this masternode scheduled to get paid soon?
@@ -491,10 +581,15 @@ bool CMasternodePayments::IsScheduled(const masternode_info_t& mnInfo, int nNotB
     CScript mnpayee;
     mnpayee = GetScriptForDestination(mnInfo.pubKeyCollateralAddress.GetID());
 
-    CScript payee;
-    for(int64_t h = nCachedBlockHeight; h <= nCachedBlockHeight + 8; h++){
-        if(h == nNotBlockHeight) continue;
-        if(GetBlockPayee(h, payee) && mnpayee == payee) {
+    const auto itPayee = mapPayeeVoteCounts.find(mnpayee);
+    if(itPayee == mapPayeeVoteCounts.end()) return false;
+
+    // it can only be the best payee of blocks it got votes for
+    const std::map<int, int>& mapVoteCounts = itPayee->second;
+    for(auto it = mapVoteCounts.lower_bound(nCachedBlockHeight); it != mapVoteCounts.end() && it->first <= nCachedBlockHeight + 8; ++it) {
+        if(it->first == nNotBlockHeight) continue;
+        const auto itBest = mapBestPayees.find(it->first);
+        if(itBest != mapBestPayees.end() && itBest->second == mnpayee) {
             return true;
         }
     }
@@ -502,6 +597,64 @@ bool CMasternodePayments::IsScheduled(const masternode_info_t& mnInfo, int nNotB
     return false;
 }
 
+std::vector<int> CMasternodePayments::GetPayeeBlockHeights(const CScript& payee, int nVotesReq, int nHeightMin, int nHeightMax) const
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    std::vector<int> vecHeights;
+    const auto itPayee = mapPayeeVoteCounts.find(payee);
+    if(itPayee == mapPayeeVoteCounts.end()) return vecHeights;
+
+    const std::map<int, int>& mapVoteCounts = itPayee->second;
+    for(auto it = mapVoteCounts.upper_bound(nHeightMax); it != mapVoteCounts.begin(); ) {
+        --it;
+        if(it->first < nHeightMin) break;
+        if(it->second >= nVotesReq) {
+            vecHeights.push_back(it->first);
+        }
+    }
+    return vecHeights;
+}
+
+void CMasternodePayments::IndexBlockPayees(const CMasternodeBlockPayees& blockPayees)
+{
+    AssertLockHeld(cs_mapMasternodeBlocks);
+
+    for (const auto& payee : blockPayees.vecPayees) {
+        mapPayeeVoteCounts[payee.GetPayee()][blockPayees.nBlockHeight] = payee.GetVoteCount();
+    }
+    CScript payeeBest;
+    if(!blockPayees.vecPayees.empty() && blockPayees.GetBestPayee(payeeBest)) {
+        mapBestPayees[blockPayees.nBlockHeight] = payeeBest;
+    }
+}
+
+void CMasternodePayments::UnindexBlockPayees(const CMasternodeBlockPayees& blockPayees)
+{
+    AssertLockHeld(cs_mapMasternodeBlocks);
+
+    for (const auto& payee : blockPayees.vecPayees) {
+        auto itPayee = mapPayeeVoteCounts.find(payee.GetPayee());
+        if(itPayee == mapPayeeVoteCounts.end()) continue;
+        itPayee->second.erase(blockPayees.nBlockHeight);
+        if(itPayee->second.empty()) {
+            mapPayeeVoteCounts.erase(itPayee);
+        }
+    }
+    mapBestPayees.erase(blockPayees.nBlockHeight);
+}
+
+void CMasternodePayments::RebuildPayeeIndex()
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    mapPayeeVoteCounts.clear();
+    mapBestPayees.clear();
+    for (const auto& pair : mapMasternodeBlocks) {
+        IndexBlockPayees(pair.second);
+    }
+}
+
 bool CMasternodePayments::AddOrUpdatePaymentVote(const CMasternodePaymentVote& vote)
 {
     uint256 blockHash = uint256();
@@ -516,7 +669,9 @@ bool CMasternodePayments::AddOrUpdatePaymentVote(const CMasternodePaymentVote& v
     mapMasternodePaymentVotes[nVoteHash] = vote;
 
     auto it = mapMasternodeBlocks.emplace(vote.nBlockHeight, CMasternodeBlockPayees(vote.nBlockHeight)).first;
+    UnindexBlockPayees(it->second);
     it->second.AddPayee(vote);
+    IndexBlockPayees(it->second);
 
     LogPrint("mnpayments", "CMasternodePayments::AddOrUpdatePaymentVote -- added, hash=%s\n", nVoteHash.ToString());
 
@@ -680,7 +835,11 @@ void CMasternodePayments::CheckAndRemove()
         if(nCachedBlockHeight - vote.nBlockHeight > nLimit) {
             LogPrint("mnpayments", "CMasternodePayments::CheckAndRemove -- Removing old Masternode payment: nBlockHeight=%d\n", vote.nBlockHeight);
             mapMasternodePaymentVotes.erase(it++);
-            mapMasternodeBlocks.erase(vote.nBlockHeight);
+            auto itBlock = mapMasternodeBlocks.find(vote.nBlockHeight);
+            if(itBlock != mapMasternodeBlocks.end()) {
+                UnindexBlockPayees(itBlock->second);
+                mapMasternodeBlocks.erase(itBlock);
+            }
         } else {
             ++it;
         }
@@ -26,8 +26,12 @@ static const int MNPAYMENTS_SIGNATURES_TOTAL            = 10;
 static const int MIN_MASTERNODE_PAYMENT_PROTO_VERSION_1 = 70206;
 static const int MIN_MASTERNODE_PAYMENT_PROTO_VERSION_2 = 70210;
 
+//! number of queued payment votes which triggers a batch signature check
+static const size_t MNPAYMENTS_VOTE_CHECK_BATCH_SIZE    = 64;
+
 extern CCriticalSection cs_vecPayees;
 extern CCriticalSection cs_mapMasternodeBlocks;
+extern CCriticalSection cs_mapMasternodePaymentVotes;
 extern CCriticalSection cs_mapMasternodePayeeVotes;
 
 extern CMasternodePayments mnpayments;
@@ -170,6 +174,56 @@ public:
     std::string ToString() const;
 };
 
+/**
+ * A payment vote which passed the cheap checks and is waiting for its
+ * signature to be verified. fValid and nDos are filled in by the check.
+ */
+struct CPendingPaymentVote
+{
+    CMasternodePaymentVote vote;
+    NodeId nodeId;
+    CPubKey pubKeyMasternode;
+    int nValidationHeight;
+    bool fValid;
+    int nDos;
+
+    CPendingPaymentVote(const CMasternodePaymentVote& voteIn, NodeId nodeIdIn, const CPubKey& pubKeyMasternodeIn, int nValidationHeightIn) :
+        vote(voteIn),
+        nodeId(nodeIdIn),
+        pubKeyMasternode(pubKeyMasternodeIn),
+        nValidationHeight(nValidationHeightIn),
+        fValid(false),
+        nDos(0)
+        {}
+};
+
+/**
+ * Closure representing the signature check of one pending payment vote.
+ * The result is stored in the pending vote itself and the check always
+ * succeeds, so one bad vote doesn't stop the rest of the batch from being
+ * verified.
+ */
+class CPaymentVoteCheck
+{
+private:
+    CPendingPaymentVote* pPendingVote;
+
+public:
+    CPaymentVoteCheck() : pPendingVote(NULL) {}
+    explicit CPaymentVoteCheck(CPendingPaymentVote* pPendingVoteIn) : pPendingVote(pPendingVoteIn) {}
+
+    bool operator()();
+
+    void swap(CPaymentVoteCheck& check) {
+        std::swap(pPendingVote, check.pPendingVote);
+    }
+};
+
+/** Run an instance of the payment vote checking thread */
+void ThreadPaymentVoteCheck();
+/** Verify the signatures of pending votes not yet marked as valid, on the vote check threads when there are any */
+void CheckPaymentVoteSignatures(std::vector<CPendingPaymentVote>& vecVotes);
+
 //
 // Masternode Payments Class
 // Keeps track of who should get paid for which blocks
@@ -186,6 +240,22 @@ private:
     // Keep track of current block height
     int nCachedBlockHeight;
 
+    // Votes waiting for a batch signature check, in the order they were received
+    CCriticalSection cs_vecPendingVotes;
+    std::vector<CPendingPaymentVote> vecPendingVotes;
+    // Makes sure batches are applied one at a time, in order
+    CCriticalSection cs_ProcessPendingVotes;
+
+    // Vote count of every payee by block height and the best payee of every block,
+    // kept in step with mapMasternodeBlocks. Protected by cs_mapMasternodeBlocks.
+    std::map<CScript, std::map<int, int> > mapPayeeVoteCounts;
+    std::map<int, CScript> mapBestPayees;
+
+    /// Add or remove the payees of a block to/from the index. Must be called while holding cs_mapMasternodeBlocks
+    void IndexBlockPayees(const CMasternodeBlockPayees& blockPayees);
+    void UnindexBlockPayees(const CMasternodeBlockPayees& blockPayees);
+    void RebuildPayeeIndex();
+
 public:
     std::map<uint256, CMasternodePaymentVote> mapMasternodePaymentVotes;
     std::map<int, CMasternodeBlockPayees> mapMasternodeBlocks;
@@ -198,8 +268,14 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
+        // dumped periodically while running, the maps are in use by the other threads
+        LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
+        LOCK(cs_vecPayees);
         READWRITE(mapMasternodePaymentVotes);
         READWRITE(mapMasternodeBlocks);
+        if(ser_action.ForRead()) {
+            RebuildPayeeIndex();
+        }
     }
 
     void Clear();
@@ -216,9 +292,16 @@ public:
     bool GetBlockPayee(int nBlockHeight, CScript& payeeRet) const;
     bool IsTransactionValid(const CTransaction& txNew, int nBlockHeight) const;
     bool IsScheduled(const masternode_info_t& mnInfo, int nNotBlockHeight) const;
+    /// Heights between nHeightMin and nHeightMax where payee has at least nVotesReq votes, highest first
+    std::vector<int> GetPayeeBlockHeights(const CScript& payee, int nVotesReq, int nHeightMin, int nHeightMax) const;
 
     bool UpdateLastVote(const CMasternodePaymentVote& vote);
 
+    /// Queue a vote for the next batch signature check, returns true once the batch is full
+    bool AddPendingVote(const CPendingPaymentVote& pendingVote);
+    /// Verify and apply all queued votes, in the order they were queued
+    void ProcessPendingVotes(CConnman& connman);
+
     int GetMinMasternodePaymentsProto() const;
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
     std::string GetRequiredPaymentsString(int nBlockHeight) const;
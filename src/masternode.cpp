@@ -128,6 +128,17 @@ CMasternode::CollateralStatus CMasternode::CheckCollateral(const COutPoint& outp
     return COLLATERAL_OK;
 }
 
+void CMasternode::PoSeBan(int nBanHeight)
+{
+    LOCK(cs);
+    nPoSeBanScore = MASTERNODE_POSE_BAN_MAX_SCORE;
+    // the same as Check() does once it sees the score, without waiting for it
+    if(IsOutpointSpent() || IsPoSeBanned()) return;
+    nActiveState = MASTERNODE_POSE_BAN;
+    nPoSeBanHeight = nBanHeight;
+    LogPrintf("CMasternode::PoSeBan -- Masternode %s is banned till block %d now\n", outpoint.ToStringShort(), nPoSeBanHeight);
+}
+
 void CMasternode::Check(bool fForce)
 {
     AssertLockHeld(cs_main);
@@ -317,34 +328,28 @@ void CMasternode::UpdateLastPaid(const CBlockIndex *pindex, int nMaxBlocksToScan
 {
     if(!pindex) return;
 
-    const CBlockIndex *BlockReading = pindex;
-
     CScript mnpayee = GetScriptForDestination(pubKeyCollateralAddress.GetID());
     // LogPrint("mnpayments", "CMasternode::UpdateLastPaidBlock -- searching for block with payment to %s\n", outpoint.ToStringShort());
 
-    LOCK(cs_mapMasternodeBlocks);
-
-    for (int i = 0; BlockReading && BlockReading->nHeight > nBlockLastPaid && i < nMaxBlocksToScanBack; i++) {
-        if(mnpayments.mapMasternodeBlocks.count(BlockReading->nHeight) &&
-            mnpayments.mapMasternodeBlocks[BlockReading->nHeight].HasPayeeWithVotes(mnpayee, 2))
-        {
-            CBlock block;
-            if(!ReadBlockFromDisk(block, BlockReading, Params().GetConsensus()))
-                continue; // shouldn't really happen
-
-            CAmount nMasternodePayment = GetMasternodePayment(BlockReading->nHeight, block.vtx[0]->GetValueOut());
-
-            for (const auto& txout : block.vtx[0]->vout)
-                if(mnpayee == txout.scriptPubKey && nMasternodePayment == txout.nValue) {
-                    nBlockLastPaid = BlockReading->nHeight;
-                    nTimeLastPaid = BlockReading->nTime;
-                    LogPrint("mnpayments", "CMasternode::UpdateLastPaidBlock -- searching for block with payment to %s -- found new %d\n", outpoint.ToStringShort(), nBlockLastPaid);
-                    return;
-                }
-        }
+    // Only blocks this masternode got at least 2 payment votes for can have paid it, newest first
+    int nHeightMin = std::max(nBlockLastPaid + 1, pindex->nHeight - nMaxBlocksToScanBack + 1);
+    for (int nHeight : mnpayments.GetPayeeBlockHeights(mnpayee, 2, nHeightMin, pindex->nHeight)) {
+        const CBlockIndex *BlockReading = pindex->GetAncestor(nHeight);
+        if(!BlockReading) continue;
+
+        CBlock block;
+        if(!ReadBlockFromDisk(block, BlockReading, Params().GetConsensus()))
+            continue; // shouldn't really happen
 
-        if (BlockReading->pprev == NULL) { assert(BlockReading); break; }
-        BlockReading = BlockReading->pprev;
+        CAmount nMasternodePayment = GetMasternodePayment(BlockReading->nHeight, block.vtx[0]->GetValueOut());
+
+        for (const auto& txout : block.vtx[0]->vout)
+            if(mnpayee == txout.scriptPubKey && nMasternodePayment == txout.nValue) {
+                nBlockLastPaid = BlockReading->nHeight;
+                nTimeLastPaid = BlockReading->nTime;
+                LogPrint("mnpayments", "CMasternode::UpdateLastPaidBlock -- searching for block with payment to %s -- found new %d\n", outpoint.ToStringShort(), nBlockLastPaid);
+                return;
+            }
     }
 
     // Last payment for this masternode wasn't found in latest mnpayments blocks
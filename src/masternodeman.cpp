@@ -13,6 +13,7 @@
 #include "messagesigner.h"
 #include "netfulfilledman.h"
 #include "netmessagemaker.h"
+#include "random.h"
 #ifdef ENABLE_WALLET
 #include "privatesend-client.h"
 #endif // ENABLE_WALLET
@@ -27,14 +28,18 @@ CMasternodeMan mnodeman;
 const std::string CMasternodeMan::SERIALIZATION_VERSION_STRING = "CMasternodeMan-Version-8";
 const int CMasternodeMan::LAST_PAID_SCAN_BLOCKS = 100;
 
-struct CompareLastPaidBlock
+SaltedKeyIDHasher::SaltedKeyIDHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+static void EraseFromKeyIndex(CMasternodeMan::key_index_t& index, const CKeyID& keyID, const COutPoint& outpoint)
 {
-    bool operator()(const std::pair<int, const CMasternode*>& t1,
-                    const std::pair<int, const CMasternode*>& t2) const
-    {
-        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->outpoint < t2.second->outpoint);
+    auto range = index.equal_range(keyID);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == outpoint) {
+            index.erase(it);
+            return;
+        }
     }
-};
+}
 
 struct CompareScoreMN
 {
@@ -58,6 +63,9 @@ struct CompareByAddr
 CMasternodeMan::CMasternodeMan():
     cs(),
     mapMasternodes(),
+    mapRankCache(RANK_CACHE_SIZE),
+    pindexCollateralHeightTip(NULL),
+    nCollateralHeightEpoch(0),
     mAskedUsForMasternodeList(),
     mWeAskedForMasternodeList(),
     mWeAskedForMasternodeListEntry(),
@@ -72,20 +80,48 @@ CMasternodeMan::CMasternodeMan():
     mapSeenMasternodeBroadcast(),
     mapSeenMasternodePing(),
     nDsqCount(0)
-{}
+{
+    for (int i = 0; i < INFO_SNAPSHOT_SHARDS; i++) {
+        vInfoSnapshot[i] = std::make_shared<const info_map_t>();
+    }
+    for (int i = 0; i < INFO_SNAPSHOT_SHARDS; i++) {
+        vIndexByPubKey[i] = std::make_shared<const key_index_t>();
+        vIndexByCollateral[i] = std::make_shared<const key_index_t>();
+    }
+}
 
 bool CMasternodeMan::Add(CMasternode &mn)
 {
     LOCK(cs);
 
-    if (Has(mn.outpoint)) return false;
+    if (mapMasternodes.count(mn.outpoint)) return false;
 
     LogPrint("masternode", "CMasternodeMan::Add -- Adding new Masternode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
     mapMasternodes[mn.outpoint] = mn;
+    UpdateInfoSnapshot(mn.outpoint);
+    ClearRankCache();
+    UpdatePaymentQueue(mn.outpoint);
     fMasternodesAdded = true;
     return true;
 }
 
+bool CMasternodeMan::Remove(const COutPoint& outpoint)
+{
+    LOCK(cs);
+
+    auto it = mapMasternodes.find(outpoint);
+    if (it == mapMasternodes.end()) return false;
+
+    LogPrint("masternode", "CMasternodeMan::Remove -- Removing Masternode: addr=%s, %i now\n", it->second.addr.ToString(), size() - 1);
+    it->second.FlagGovernanceItemsAsDirty();
+    mapMasternodes.erase(it);
+    UpdateInfoSnapshot(outpoint);
+    ClearRankCache();
+    UpdatePaymentQueue(outpoint);
+    fMasternodesRemoved = true;
+    return true;
+}
+
 void CMasternodeMan::AskForMN(CNode* pnode, const COutPoint& outpoint, CConnman& connman)
 {
     if(!pnode) return;
@@ -131,6 +167,7 @@ bool CMasternodeMan::AllowMixing(const COutPoint &outpoint)
     nDsqCount++;
     pmn->nLastDsq = nDsqCount;
     pmn->fAllowMixingTx = true;
+    UpdateInfoSnapshot(outpoint);
 
     return true;
 }
@@ -154,7 +191,9 @@ bool CMasternodeMan::PoSeBan(const COutPoint &outpoint)
     if (!pmn) {
         return false;
     }
-    pmn->PoSeBan();
+    // ban for the whole payment cycle, cs_main can't be taken here so this doesn't wait for Check()
+    pmn->PoSeBan(nCachedBlockHeight + mapMasternodes.size());
+    UpdateInfoSnapshot(outpoint);
 
     return true;
 }
@@ -170,6 +209,7 @@ void CMasternodeMan::Check()
         // since the last time, so expect some MNs to skip this
         mnpair.second.Check();
     }
+    UpdateInfoSnapshot();
 }
 
 void CMasternodeMan::CheckAndRemove(CConnman& connman)
@@ -202,9 +242,9 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
                 mWeAskedForMasternodeListEntry.erase(it->first);
 
                 // and finally remove it from the list
-                it->second.FlagGovernanceItemsAsDirty();
-                mapMasternodes.erase(it++);
-                fMasternodesRemoved = true;
+                COutPoint outpoint = it->first;
+                ++it;
+                Remove(outpoint);
             } else {
                 bool fAsk = (nAskForMnbRecovery > 0) &&
                             masternodeSync.IsSynced() &&
@@ -261,6 +301,8 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
                 ++itMnbReplies;
             }
         }
+
+        UpdateInfoSnapshot();
     }
     {
         // no need for cm_main below
@@ -360,11 +402,16 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     mapMasternodes.clear();
+    UpdateInfoSnapshot();
+    ClearRankCache();
+    UpdatePaymentQueue();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
     mapSeenMasternodeBroadcast.clear();
     mapSeenMasternodePing.clear();
+    mapPendingPings.clear();
+    vecPendingPingMisbehaving.clear();
     nDsqCount = 0;
     nLastSentinelPingTime = 0;
 }
@@ -463,44 +510,182 @@ bool CMasternodeMan::Get(const COutPoint& outpoint, CMasternode& masternodeRet)
 
 bool CMasternodeMan::GetMasternodeInfo(const COutPoint& outpoint, masternode_info_t& mnInfoRet)
 {
-    LOCK(cs);
-    auto it = mapMasternodes.find(outpoint);
-    if (it == mapMasternodes.end()) {
+    info_map_ptr_t pInfoMap = GetInfoSnapshot(outpoint);
+    auto it = pInfoMap->find(outpoint);
+    if (it == pInfoMap->end()) {
         return false;
     }
-    mnInfoRet = it->second.GetInfo();
+    mnInfoRet = it->second;
     return true;
 }
 
 bool CMasternodeMan::GetMasternodeInfo(const CPubKey& pubKeyMasternode, masternode_info_t& mnInfoRet)
 {
-    LOCK(cs);
-    for (const auto& mnpair : mapMasternodes) {
-        if (mnpair.second.pubKeyMasternode == pubKeyMasternode) {
-            mnInfoRet = mnpair.second.GetInfo();
-            return true;
-        }
-    }
-    return false;
+    return GetMasternodeInfo(pubKeyMasternode.GetID(), false, mnInfoRet) &&
+            mnInfoRet.pubKeyMasternode == pubKeyMasternode;
 }
 
 bool CMasternodeMan::GetMasternodeInfo(const CScript& payee, masternode_info_t& mnInfoRet)
 {
-    LOCK(cs);
-    for (const auto& mnpair : mapMasternodes) {
-        CScript scriptCollateralAddress = GetScriptForDestination(mnpair.second.pubKeyCollateralAddress.GetID());
-        if (scriptCollateralAddress == payee) {
-            mnInfoRet = mnpair.second.GetInfo();
-            return true;
+    CTxDestination dest;
+    if (!ExtractDestination(payee, dest) || !boost::get<CKeyID>(&dest)) {
+        return false;
+    }
+    const CKeyID& keyID = boost::get<CKeyID>(dest);
+    // ExtractDestination also accepts P2PK, only the P2PKH script is a masternode payee
+    if (payee != GetScriptForDestination(keyID)) {
+        return false;
+    }
+    return GetMasternodeInfo(keyID, true, mnInfoRet);
+}
+
+bool CMasternodeMan::GetMasternodeInfo(const CKeyID& keyID, bool fCollateral, masternode_info_t& mnInfoRet)
+{
+    key_index_ptr_t pIndex;
+    {
+        LOCK(cs_infoSnapshot);
+        pIndex = (fCollateral ? vIndexByCollateral : vIndexByPubKey)[GetKeyIndexShard(keyID)];
+    }
+
+    // When entries share a key return the lowest outpoint, as a scan of mapMasternodes would
+    auto range = pIndex->equal_range(keyID);
+    if (range.first == range.second) {
+        return false;
+    }
+    COutPoint outpoint = range.first->second;
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second < outpoint) {
+            outpoint = it->second;
         }
     }
-    return false;
+    return GetMasternodeInfo(outpoint, mnInfoRet);
 }
 
 bool CMasternodeMan::Has(const COutPoint& outpoint)
 {
-    LOCK(cs);
-    return mapMasternodes.find(outpoint) != mapMasternodes.end();
+    return GetInfoSnapshot(outpoint)->count(outpoint);
+}
+
+int CMasternodeMan::GetInfoSnapshotShard(const COutPoint& outpoint)
+{
+    return (outpoint.hash.GetCheapHash() + outpoint.n) % INFO_SNAPSHOT_SHARDS;
+}
+
+int CMasternodeMan::GetKeyIndexShard(const CKeyID& keyID)
+{
+    return keyID.GetUint64(0) % INFO_SNAPSHOT_SHARDS;
+}
+
+CMasternodeMan::info_map_ptr_t CMasternodeMan::GetInfoSnapshot(const COutPoint& outpoint) const
+{
+    LOCK(cs_infoSnapshot);
+    return vInfoSnapshot[GetInfoSnapshotShard(outpoint)];
+}
+
+std::vector<CMasternodeMan::info_map_ptr_t> CMasternodeMan::GetInfoSnapshot() const
+{
+    LOCK(cs_infoSnapshot);
+    return std::vector<info_map_ptr_t>(vInfoSnapshot, vInfoSnapshot + INFO_SNAPSHOT_SHARDS);
+}
+
+void CMasternodeMan::UpdateInfoSnapshot(const COutPoint& outpoint)
+{
+    UpdateInfoSnapshot(std::set<COutPoint>{outpoint});
+}
+
+void CMasternodeMan::UpdateInfoSnapshot(const std::set<COutPoint>& setOutpoints)
+{
+    AssertLockHeld(cs);
+
+    if (setOutpoints.empty()) return;
+
+    // only writers replace shards and they all hold cs, so the old ones can be read without cs_infoSnapshot
+    std::map<int, std::shared_ptr<info_map_t> > mapInfoMaps;
+    key_index_ptr_t vByPubKey[INFO_SNAPSHOT_SHARDS];
+    key_index_ptr_t vByCollateral[INFO_SNAPSHOT_SHARDS];
+    std::copy(vIndexByPubKey, vIndexByPubKey + INFO_SNAPSHOT_SHARDS, vByPubKey);
+    std::copy(vIndexByCollateral, vIndexByCollateral + INFO_SNAPSHOT_SHARDS, vByCollateral);
+    for (const auto& outpoint : setOutpoints) {
+        // each shard is copied once, however many of its entries changed
+        int nShard = GetInfoSnapshotShard(outpoint);
+        std::shared_ptr<info_map_t>& pInfoMap = mapInfoMaps[nShard];
+        if (!pInfoMap) {
+            pInfoMap = std::make_shared<info_map_t>(*vInfoSnapshot[nShard]);
+        }
+        masternode_info_t infoOld;
+        auto itOld = pInfoMap->find(outpoint);
+        if (itOld != pInfoMap->end()) {
+            infoOld = itOld->second;
+        }
+        masternode_info_t infoNew;
+        auto it = mapMasternodes.find(outpoint);
+        if (it == mapMasternodes.end()) {
+            pInfoMap->erase(outpoint);
+        } else {
+            infoNew = it->second.GetInfo();
+            (*pInfoMap)[outpoint] = infoNew;
+        }
+
+        // pings and state changes leave the keys alone, only copy the index shards when they don't
+        if (infoOld.fInfoValid != infoNew.fInfoValid || infoOld.pubKeyMasternode != infoNew.pubKeyMasternode) {
+            if (infoOld.fInfoValid) UpdateKeyIndex(vByPubKey, infoOld.pubKeyMasternode.GetID(), outpoint, false);
+            if (infoNew.fInfoValid) UpdateKeyIndex(vByPubKey, infoNew.pubKeyMasternode.GetID(), outpoint, true);
+        }
+        if (infoOld.fInfoValid != infoNew.fInfoValid || infoOld.pubKeyCollateralAddress != infoNew.pubKeyCollateralAddress) {
+            if (infoOld.fInfoValid) UpdateKeyIndex(vByCollateral, infoOld.pubKeyCollateralAddress.GetID(), outpoint, false);
+            if (infoNew.fInfoValid) UpdateKeyIndex(vByCollateral, infoNew.pubKeyCollateralAddress.GetID(), outpoint, true);
+        }
+    }
+
+    LOCK(cs_infoSnapshot);
+    for (const auto& pair : mapInfoMaps) {
+        vInfoSnapshot[pair.first] = pair.second;
+    }
+    std::copy(vByPubKey, vByPubKey + INFO_SNAPSHOT_SHARDS, vIndexByPubKey);
+    std::copy(vByCollateral, vByCollateral + INFO_SNAPSHOT_SHARDS, vIndexByCollateral);
+}
+
+void CMasternodeMan::UpdateKeyIndex(key_index_ptr_t* vIndex, const CKeyID& keyID, const COutPoint& outpoint, bool fAdd)
+{
+    int nShard = GetKeyIndexShard(keyID);
+    std::shared_ptr<key_index_t> pIndex = std::make_shared<key_index_t>(*vIndex[nShard]);
+    if (fAdd) {
+        pIndex->emplace(keyID, outpoint);
+    } else {
+        EraseFromKeyIndex(*pIndex, keyID, outpoint);
+    }
+    vIndex[nShard] = pIndex;
+}
+
+void CMasternodeMan::UpdateInfoSnapshot()
+{
+    AssertLockHeld(cs);
+
+    std::vector<std::shared_ptr<info_map_t> > vInfoMaps;
+    for (int i = 0; i < INFO_SNAPSHOT_SHARDS; i++) {
+        vInfoMaps.push_back(std::make_shared<info_map_t>());
+    }
+    std::vector<std::shared_ptr<key_index_t> > vByPubKey;
+    std::vector<std::shared_ptr<key_index_t> > vByCollateral;
+    for (int i = 0; i < INFO_SNAPSHOT_SHARDS; i++) {
+        vByPubKey.push_back(std::make_shared<key_index_t>());
+        vByCollateral.push_back(std::make_shared<key_index_t>());
+    }
+    for (const auto& mnpair : mapMasternodes) {
+        info_map_t& mapInfo = *vInfoMaps[GetInfoSnapshotShard(mnpair.first)];
+        mapInfo.emplace_hint(mapInfo.end(), mnpair.first, mnpair.second.GetInfo());
+        CKeyID keyIDMasternode = mnpair.second.pubKeyMasternode.GetID();
+        CKeyID keyIDCollateral = mnpair.second.pubKeyCollateralAddress.GetID();
+        vByPubKey[GetKeyIndexShard(keyIDMasternode)]->emplace(keyIDMasternode, mnpair.first);
+        vByCollateral[GetKeyIndexShard(keyIDCollateral)]->emplace(keyIDCollateral, mnpair.first);
+    }
+
+    LOCK(cs_infoSnapshot);
+    for (int i = 0; i < INFO_SNAPSHOT_SHARDS; i++) {
+        vInfoSnapshot[i] = vInfoMaps[i];
+        vIndexByPubKey[i] = vByPubKey[i];
+        vIndexByCollateral[i] = vByCollateral[i];
+    }
 }
 
 //
@@ -521,70 +706,174 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
         return false;
     }
 
-    // Need LOCK2 here to ensure consistent locking order because the GetBlockHash call below locks cs_main
-    LOCK2(cs_main,cs);
+    // Everything needed from the chain is taken up front, the scan itself only holds cs
+    uint256 blockHash;
+    bool fBlockHash = GetBlockHash(blockHash, nBlockHeight - 101);
+    int nChainHeight;
+    {
+        LOCK(cs_main);
+        nChainHeight = chainActive.Height();
+    }
+    UpdateCollateralHeights();
+
+    {
+        LOCK(cs);
 
-    std::vector<std::pair<int, const CMasternode*> > vecMasternodeLastPaid;
+        int nMnCount = CountMasternodes();
+        int nMinProtocol = mnpayments.GetMinMasternodePaymentsProto();
 
-    /*
-        Make a vector with all of the last paid times
-    */
+        /*
+            Walk the payment queue, it's already sorted by last paid block, low to high
+        */
 
-    int nMnCount = CountMasternodes();
+        std::vector<const CMasternode*> vecMasternodeLastPaid;
+        for (const auto& queuedPair : setPaymentQueue) {
+            const COutPoint& outpoint = queuedPair.second;
+            const CMasternode& mn = mapMasternodes.at(outpoint);
 
-    for (const auto& mnpair : mapMasternodes) {
-        if(!mnpair.second.IsValidForPayment()) continue;
+            if(!mn.IsValidForPayment()) continue;
 
-        //check protocol version
-        if(mnpair.second.nProtocolVersion < mnpayments.GetMinMasternodePaymentsProto()) continue;
+            //check protocol version
+            if(mn.nProtocolVersion < nMinProtocol) continue;
 
-        //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
-        if(mnpayments.IsScheduled(mnpair.second, nBlockHeight)) continue;
+            //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
+            if(mnpayments.IsScheduled(mn, nBlockHeight)) continue;
 
-        //it's too new, wait for a cycle
-        if(fFilterSigTime && mnpair.second.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
+            //it's too new, wait for a cycle
+            if(fFilterSigTime && mn.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
 
-        //make sure it has at least as many confirmations as there are masternodes
-        if(GetUTXOConfirmations(mnpair.first) < nMnCount) continue;
+            //make sure it has at least as many confirmations as there are masternodes
+            auto itHeight = mapCollateralHeight.find(outpoint);
+            if(itHeight == mapCollateralHeight.end() || nChainHeight - itHeight->second + 1 < nMnCount) continue;
 
-        vecMasternodeLastPaid.push_back(std::make_pair(mnpair.second.GetLastPaidBlock(), &mnpair.second));
+            vecMasternodeLastPaid.push_back(&mn);
+        }
+
+        nCountRet = (int)vecMasternodeLastPaid.size();
+
+        //when the network is in the process of upgrading, don't penalize nodes that recently restarted
+        bool fRetry = fFilterSigTime && nCountRet < nMnCount/3;
+        if(!fRetry) {
+            if(!fBlockHash) {
+                LogPrintf("CMasternode::GetNextMasternodeInQueueForPayment -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", nBlockHeight - 101);
+                return false;
+            }
+            // Look at 1/10 of the oldest nodes (by last payment), calculate their scores and pay the best one
+            //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
+            //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
+            //  -- (chance per block * chances before IsScheduled will fire)
+            int nTenthNetwork = nMnCount/10;
+            int nCountTenth = 0;
+            arith_uint256 nHighest = 0;
+            const CMasternode *pBestMasternode = NULL;
+            for (const auto& pmn : vecMasternodeLastPaid) {
+                arith_uint256 nScore = pmn->CalculateScore(blockHash);
+                if(nScore > nHighest){
+                    nHighest = nScore;
+                    pBestMasternode = pmn;
+                }
+                nCountTenth++;
+                if(nCountTenth >= nTenthNetwork) break;
+            }
+            if (pBestMasternode) {
+                mnInfoRet = pBestMasternode->GetInfo();
+            }
+            return mnInfoRet.fInfoValid;
+        }
     }
 
-    nCountRet = (int)vecMasternodeLastPaid.size();
+    // retry without cs held, the call takes cs_main again
+    return GetNextMasternodeInQueueForPayment(nBlockHeight, false, nCountRet, mnInfoRet);
+}
 
-    //when the network is in the process of upgrading, don't penalize nodes that recently restarted
-    if(fFilterSigTime && nCountRet < nMnCount/3)
-        return GetNextMasternodeInQueueForPayment(nBlockHeight, false, nCountRet, mnInfoRet);
+void CMasternodeMan::UpdatePaymentQueue(const COutPoint& outpoint)
+{
+    AssertLockHeld(cs);
 
-    // Sort them low to high
-    sort(vecMasternodeLastPaid.begin(), vecMasternodeLastPaid.end(), CompareLastPaidBlock());
+    auto it = mapMasternodes.find(outpoint);
+    auto itQueued = mapPaymentQueueLastPaid.find(outpoint);
+    if (itQueued != mapPaymentQueueLastPaid.end()) {
+        if (it != mapMasternodes.end() && it->second.GetLastPaidBlock() == itQueued->second) {
+            return;
+        }
+        setPaymentQueue.erase(std::make_pair(itQueued->second, outpoint));
+        mapPaymentQueueLastPaid.erase(itQueued);
+    }
 
-    uint256 blockHash;
-    if(!GetBlockHash(blockHash, nBlockHeight - 101)) {
-        LogPrintf("CMasternode::GetNextMasternodeInQueueForPayment -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", nBlockHeight - 101);
-        return false;
+    if (it == mapMasternodes.end()) {
+        mapCollateralHeight.erase(outpoint);
+        setCollateralHeightUnknown.erase(outpoint);
+        return;
+    }
+
+    setPaymentQueue.insert(std::make_pair(it->second.GetLastPaidBlock(), outpoint));
+    mapPaymentQueueLastPaid.insert(std::make_pair(outpoint, it->second.GetLastPaidBlock()));
+    if (!mapCollateralHeight.count(outpoint)) {
+        setCollateralHeightUnknown.insert(outpoint);
+    }
+}
+
+void CMasternodeMan::UpdatePaymentQueue()
+{
+    AssertLockHeld(cs);
+
+    std::map<COutPoint, int> mapCollateralHeightOld;
+    mapCollateralHeightOld.swap(mapCollateralHeight);
+    setPaymentQueue.clear();
+    mapPaymentQueueLastPaid.clear();
+    setCollateralHeightUnknown.clear();
+
+    for (const auto& mnpair : mapMasternodes) {
+        auto itHeight = mapCollateralHeightOld.find(mnpair.first);
+        if (itHeight != mapCollateralHeightOld.end()) {
+            mapCollateralHeight.insert(*itHeight);
+        }
+        UpdatePaymentQueue(mnpair.first);
+    }
+}
+
+void CMasternodeMan::UpdateCollateralHeights()
+{
+    std::set<COutPoint> setUnknown;
+    int nEpoch;
+    {
+        LOCK(cs);
+        setUnknown = setCollateralHeightUnknown;
+        nEpoch = nCollateralHeightEpoch;
     }
-    // Look at 1/10 of the oldest nodes (by last payment), calculate their scores and pay the best one
-    //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
-    //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
-    //  -- (chance per block * chances before IsScheduled will fire)
-    int nTenthNetwork = nMnCount/10;
-    int nCountTenth = 0;
-    arith_uint256 nHighest = 0;
-    const CMasternode *pBestMasternode = NULL;
-    for (const auto& s : vecMasternodeLastPaid) {
-        arith_uint256 nScore = s.second->CalculateScore(blockHash);
-        if(nScore > nHighest){
-            nHighest = nScore;
-            pBestMasternode = s.second;
+    if (setUnknown.empty()) return;
+
+    std::map<COutPoint, int> mapFound;
+    {
+        LOCK(cs_main);
+        for (const auto& outpoint : setUnknown) {
+            int nHeight = GetUTXOHeight(outpoint);
+            if (nHeight > -1) {
+                mapFound.insert(std::make_pair(outpoint, nHeight));
+            }
         }
-        nCountTenth++;
-        if(nCountTenth >= nTenthNetwork) break;
     }
-    if (pBestMasternode) {
-        mnInfoRet = pBestMasternode->GetInfo();
+
+    LOCK(cs);
+    // the chain was reorganized meanwhile, these may be from the old one
+    if (nEpoch != nCollateralHeightEpoch) return;
+    for (const auto& heightPair : mapFound) {
+        // skip entries removed meanwhile
+        if (setCollateralHeightUnknown.erase(heightPair.first)) {
+            mapCollateralHeight.insert(heightPair);
+        }
     }
-    return mnInfoRet.fInfoValid;
+}
+
+void CMasternodeMan::InvalidateCollateralHeights()
+{
+    AssertLockHeld(cs);
+
+    for (const auto& heightPair : mapCollateralHeight) {
+        setCollateralHeightUnknown.insert(heightPair.first);
+    }
+    mapCollateralHeight.clear();
+    nCollateralHeightEpoch++;
 }
 
 masternode_info_t CMasternodeMan::FindRandomNotInVec(const std::vector<COutPoint> &vecToExclude, int nProtocolVersion)
@@ -667,22 +956,16 @@ bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet,
         return false;
     }
 
-    LOCK(cs);
-
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    masternode_ranks_ptr_t pRanks;
+    if (!GetMasternodeRanks(nBlockHash, nMinProtocol, pRanks))
         return false;
 
-    int nRank = 0;
-    for (const auto& scorePair : vecMasternodeScores) {
-        nRank++;
-        if(scorePair.second->outpoint == outpoint) {
-            nRankRet = nRank;
-            return true;
-        }
-    }
+    auto it = pRanks->mapRanks.find(outpoint);
+    if (it == pRanks->mapRanks.end())
+        return false;
 
-    return false;
+    nRankRet = it->second;
+    return true;
 }
 
 bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMasternodeRanksRet, int nBlockHeight, int nMinProtocol)
@@ -701,19 +984,58 @@ bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMast
 
     LOCK(cs);
 
+    masternode_ranks_ptr_t pRanks;
+    if (!GetMasternodeRanks(nBlockHash, nMinProtocol, pRanks))
+        return false;
+
+    // the cache is cleared on every list change under cs, all entries are there
+    int nRank = 0;
+    for (const auto& outpoint : pRanks->vecOutpoints) {
+        nRank++;
+        vecMasternodeRanksRet.push_back(std::make_pair(nRank, mapMasternodes.at(outpoint)));
+    }
+
+    return true;
+}
+
+bool CMasternodeMan::GetMasternodeRanks(const uint256& nBlockHash, int nMinProtocol, CMasternodeMan::masternode_ranks_ptr_t& pRanksRet)
+{
+    std::pair<uint256, int> key = std::make_pair(nBlockHash, nMinProtocol);
+    {
+        LOCK(cs_rankCache);
+        if (mapRankCache.Get(key, pRanksRet))
+            return true;
+    }
+
+    LOCK(cs);
+
     score_pair_vec_t vecMasternodeScores;
     if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
         return false;
 
+    std::shared_ptr<masternode_ranks_t> pRanks = std::make_shared<masternode_ranks_t>();
+    pRanks->vecOutpoints.reserve(vecMasternodeScores.size());
+    pRanks->mapRanks.reserve(vecMasternodeScores.size());
     int nRank = 0;
     for (const auto& scorePair : vecMasternodeScores) {
         nRank++;
-        vecMasternodeRanksRet.push_back(std::make_pair(nRank, *scorePair.second));
+        pRanks->vecOutpoints.push_back(scorePair.second->outpoint);
+        pRanks->mapRanks.emplace(scorePair.second->outpoint, nRank);
     }
+    pRanksRet = pRanks;
 
+    LOCK(cs_rankCache);
+    mapRankCache.Insert(key, pRanksRet);
     return true;
 }
 
+void CMasternodeMan::ClearRankCache()
+{
+    AssertLockHeld(cs);
+    LOCK(cs_rankCache);
+    mapRankCache.Clear();
+}
+
 void CMasternodeMan::ProcessMasternodeConnections(CConnman& connman)
 {
     //we don't care about this for regtest
@@ -801,6 +1123,136 @@ void CMasternodeMan::ProcessPendingMnbRequests(CConnman& connman)
     LogPrint("masternode", "%s -- mapPendingMNB size: %d\n", __func__, mapPendingMNB.size());
 }
 
+bool CMasternodeMan::AddPendingPing(const CMasternodePing& mnp, NodeId nodeId)
+{
+    LOCK(cs);
+
+    // Pings are checked in batches by ProcessPendingPings, which is the only place
+    // taking cs_main for them. A newer ping from the same masternode replaces the
+    // queued one, the older ping would be rejected as arriving too early anyway.
+    // The newer one has to have a valid signature though, or a forged ping with a
+    // later sigTime would keep the real one out until the masternode pings again.
+    CPendingMasternodePing pendingNew(mnp, nodeId, GetTimeMicros());
+    auto it = mapPendingPings.find(mnp.masternodeOutpoint);
+    if(it == mapPendingPings.end()) {
+        mapPendingPings.emplace(mnp.masternodeOutpoint, pendingNew);
+    } else {
+        pingQueueStats.nSuperseded++;
+        bool fReplace = it->second.mnp.sigTime < mnp.sigTime;
+        const CPendingMasternodePing& pendingNewer = fReplace ? pendingNew : it->second;
+        CMasternode* pmn = Find(mnp.masternodeOutpoint);
+        int nDos = 0;
+        if(pmn && !pendingNewer.mnp.CheckSignature(pmn->pubKeyMasternode, nDos)) {
+            if(nDos > 0) vecPendingPingMisbehaving.emplace_back(pendingNewer.nodeId, nDos);
+            fReplace = !fReplace;
+        }
+        // without the masternode the winner isn't verified, let relays of the other ping through again
+        if(!pmn) {
+            mapSeenMasternodePing.erase(fReplace ? it->second.mnp.GetHash() : mnp.GetHash());
+        }
+        if(!fReplace) return false;
+        it->second = pendingNew;
+    }
+    pingQueueStats.nMaxQueued = std::max(pingQueueStats.nMaxQueued, mapPendingPings.size());
+    return mapPendingPings.size() >= PING_BATCH_SIZE;
+}
+
+void CMasternodeMan::ProcessPendingPings(CConnman& connman)
+{
+    std::map<COutPoint, CPendingMasternodePing> mapPings;
+    std::vector<std::pair<NodeId, int> > vecMisbehaving;
+    {
+        LOCK(cs);
+        mapPings.swap(mapPendingPings);
+        vecMisbehaving.swap(vecPendingPingMisbehaving);
+    }
+    if(mapPings.empty() && vecMisbehaving.empty()) return;
+
+    // Verify signatures before taking cs_main, CheckAndUpdate below checks them
+    // again but gets the answer from the message signature cache. Without the
+    // cache that would only verify every signature twice.
+    if(GetMessageSignatureCacheStats().nElements != 0) {
+        for (const auto& pair : mapPings) {
+            masternode_info_t mnInfo;
+            int nDos = 0;
+            if(GetMasternodeInfo(pair.first, mnInfo)) {
+                pair.second.mnp.CheckSignature(mnInfo.pubKeyMasternode, nDos);
+            }
+        }
+    }
+
+    std::vector<std::pair<NodeId, COutPoint> > vecAskForMN;
+    {
+        // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
+        LOCK2(cs_main, cs);
+
+        for (const auto& pair : vecMisbehaving) {
+            Misbehaving(pair.first, pair.second);
+        }
+
+        int64_t nTimeNow = GetTimeMicros();
+        int64_t nMaxLatency = 0;
+        std::set<COutPoint> setUpdated;
+        for (auto& pair : mapPings) {
+            CMasternodePing& mnp = pair.second.mnp;
+            NodeId nodeId = pair.second.nodeId;
+
+            int64_t nLatency = nTimeNow - pair.second.nTimeQueued;
+            nMaxLatency = std::max(nMaxLatency, nLatency);
+            pingQueueStats.nTotalLatency += nLatency;
+
+            // see if we have this Masternode
+            CMasternode* pmn = Find(mnp.masternodeOutpoint);
+
+            if(pmn && mnp.fSentinelIsCurrent)
+                UpdateLastSentinelPingTime();
+
+            // too late, new MNANNOUNCE is required
+            if(pmn && pmn->IsNewStartRequired()) continue;
+
+            int nDos = 0;
+            bool fUpdated = mnp.CheckAndUpdate(pmn, false, nDos, connman);
+            if(pmn) setUpdated.insert(mnp.masternodeOutpoint);
+            if(fUpdated) continue;
+
+            if(nDos > 0) {
+                // if anything significant failed, mark that node
+                Misbehaving(nodeId, nDos);
+            } else if(pmn != NULL) {
+                // nothing significant failed, mn is a known one too
+                continue;
+            }
+
+            // something significant is broken or mn is unknown,
+            // we might have to ask for a masternode entry once
+            vecAskForMN.push_back(std::make_pair(nodeId, mnp.masternodeOutpoint));
+        }
+
+        UpdateInfoSnapshot(setUpdated);
+
+        pingQueueStats.nProcessed += mapPings.size();
+        pingQueueStats.nBatches++;
+        pingQueueStats.nMaxLatency = std::max(pingQueueStats.nMaxLatency, nMaxLatency);
+        LogPrint("masternode", "CMasternodeMan::%s -- processed %d pings in %dus, max latency %dus\n", __func__,
+                    mapPings.size(), GetTimeMicros() - nTimeNow, nMaxLatency);
+    }
+
+    for (const auto& pair : vecAskForMN) {
+        connman.ForNode(pair.first, [&](CNode* pnode) {
+            AskForMN(pnode, pair.second, connman);
+            return true;
+        });
+    }
+}
+
+CMasternodePingQueueStats CMasternodeMan::GetPingQueueStats()
+{
+    LOCK(cs);
+    CMasternodePingQueueStats stats = pingQueueStats;
+    stats.nQueued = mapPendingPings.size();
+    return stats;
+}
+
 void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
 {
     if(fLiteMode) return; // disable all Kepler specific functionality
@@ -842,38 +1294,19 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
 
         LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s\n", mnp.masternodeOutpoint.ToStringShort());
 
-        // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
-        LOCK2(cs_main, cs);
+        {
+            LOCK(cs);
 
-        if(mapSeenMasternodePing.count(nHash)) return; //seen
-        mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
+            if(mapSeenMasternodePing.count(nHash)) return; //seen
+            mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
+        }
 
         LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s new\n", mnp.masternodeOutpoint.ToStringShort());
 
-        // see if we have this Masternode
-        CMasternode* pmn = Find(mnp.masternodeOutpoint);
-
-        if(pmn && mnp.fSentinelIsCurrent)
-            UpdateLastSentinelPingTime();
-
-        // too late, new MNANNOUNCE is required
-        if(pmn && pmn->IsNewStartRequired()) return;
-
-        int nDos = 0;
-        if(mnp.CheckAndUpdate(pmn, false, nDos, connman)) return;
-
-        if(nDos > 0) {
-            // if anything significant failed, mark that node
-            Misbehaving(pfrom->GetId(), nDos);
-        } else if(pmn != NULL) {
-            // nothing significant failed, mn is a known one too
-            return;
+        if(AddPendingPing(mnp, pfrom->GetId())) {
+            ProcessPendingPings(connman);
         }
 
-        // something significant is broken or mn is unknown,
-        // we might have to ask for a masternode entry once
-        AskForMN(pfrom, mnp.masternodeOutpoint, connman);
-
     } else if (strCommand == NetMsgType::DSEG) { //Get Masternode list or specific entry
         // Ignore such requests until we are fully synced.
         // We could start processing this after masternode list is synced
@@ -1558,7 +1991,11 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
         CMasternode* pmn = Find(mnb.outpoint);
         if(pmn) {
             CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-            if(!mnb.Update(pmn, nDos, connman)) {
+            bool fUpdated = mnb.Update(pmn, nDos, connman);
+            UpdateInfoSnapshot(mnb.outpoint);
+            ClearRankCache();
+            UpdatePaymentQueue(mnb.outpoint);
+            if(!fUpdated) {
                 LogPrint("masternode", "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- Update() failed, masternode=%s\n", mnb.outpoint.ToStringShort());
                 return false;
             }
@@ -1611,8 +2048,13 @@ void CMasternodeMan::UpdateLastPaid(const CBlockIndex* pindex)
                             nCachedBlockHeight, nLastRunBlockHeight, nMaxBlocksToScanBack);
 
     for (auto& mnpair : mapMasternodes) {
+        int nBlockLastPaidOld = mnpair.second.GetLastPaidBlock();
         mnpair.second.UpdateLastPaid(pindex, nMaxBlocksToScanBack);
+        if (mnpair.second.GetLastPaidBlock() != nBlockLastPaidOld) {
+            UpdatePaymentQueue(mnpair.first);
+        }
     }
+    UpdateInfoSnapshot();
 
     nLastRunBlockHeight = nCachedBlockHeight;
 }
@@ -1652,11 +2094,15 @@ void CMasternodeMan::RemoveGovernanceObject(uint256 nGovernanceObjectHash)
 void CMasternodeMan::CheckMasternode(const CPubKey& pubKeyMasternode, bool fForce)
 {
     LOCK2(cs_main, cs);
-    for (auto& mnpair : mapMasternodes) {
-        if (mnpair.second.pubKeyMasternode == pubKeyMasternode) {
-            mnpair.second.Check(fForce);
-            return;
-        }
+    // the snapshot is current while we hold cs
+    masternode_info_t mnInfo;
+    if (!GetMasternodeInfo(pubKeyMasternode, mnInfo)) {
+        return;
+    }
+    CMasternode* pmn = Find(mnInfo.outpoint);
+    if (pmn) {
+        pmn->Check(fForce);
+        UpdateInfoSnapshot(mnInfo.outpoint);
     }
 }
 
@@ -1675,6 +2121,7 @@ void CMasternodeMan::SetMasternodeLastPing(const COutPoint& outpoint, const CMas
         return;
     }
     pmn->lastPing = mnp;
+    UpdateInfoSnapshot(outpoint);
     if(mnp.fSentinelIsCurrent) {
         UpdateLastSentinelPingTime();
     }
@@ -1692,6 +2139,16 @@ void CMasternodeMan::UpdatedBlockTip(const CBlockIndex *pindex)
     nCachedBlockHeight = pindex->nHeight;
     LogPrint("masternode", "CMasternodeMan::UpdatedBlockTip -- nCachedBlockHeight=%d\n", nCachedBlockHeight);
 
+    {
+        LOCK(cs);
+        // blocks were disconnected, collaterals confirmed in them are at another height now or unconfirmed
+        if (pindexCollateralHeightTip && pindex->GetAncestor(pindexCollateralHeightTip->nHeight) != pindexCollateralHeightTip) {
+            LogPrint("masternode", "CMasternodeMan::UpdatedBlockTip -- reorganized, looking up %d collateral heights again\n", mapCollateralHeight.size());
+            InvalidateCollateralHeights();
+        }
+        pindexCollateralHeightTip = pindex;
+    }
+
     CheckSameAddr();
 
     if(fMasternodeMode) {
@@ -5,14 +5,60 @@
 #ifndef MASTERNODEMAN_H
 #define MASTERNODEMAN_H
 
+#include "cachemap.h"
 #include "masternode.h"
 #include "sync.h"
 
+#include <memory>
+#include <unordered_map>
+
 class CMasternodeMan;
 class CConnman;
 
 extern CMasternodeMan mnodeman;
 
+class SaltedKeyIDHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedKeyIDHasher();
+
+    size_t operator()(const CKeyID& id) const {
+        return CSipHasher(k0, k1).Write(id.begin(), id.size()).Finalize();
+    }
+};
+
+/** A ping waiting to be processed, with the peer it came from and when it was queued */
+struct CPendingMasternodePing
+{
+    CMasternodePing mnp;
+    NodeId nodeId;
+    int64_t nTimeQueued;
+
+    CPendingMasternodePing(const CMasternodePing& mnpIn, NodeId nodeIdIn, int64_t nTimeQueuedIn) :
+        mnp(mnpIn),
+        nodeId(nodeIdIn),
+        nTimeQueued(nTimeQueuedIn)
+        {}
+};
+
+/** Depth and latency (in microseconds) of the ping queue */
+struct CMasternodePingQueueStats
+{
+    size_t nQueued;
+    size_t nMaxQueued;
+    uint64_t nProcessed;
+    uint64_t nSuperseded;
+    uint64_t nBatches;
+    int64_t nTotalLatency;
+    int64_t nMaxLatency;
+
+    CMasternodePingQueueStats() : nQueued(0), nMaxQueued(0), nProcessed(0), nSuperseded(0), nBatches(0), nTotalLatency(0), nMaxLatency(0) {}
+};
+
 class CMasternodeMan
 {
 public:
@@ -20,6 +66,17 @@ public:
     typedef std::vector<score_pair_t> score_pair_vec_t;
     typedef std::pair<int, const CMasternode> rank_pair_t;
     typedef std::vector<rank_pair_t> rank_pair_vec_t;
+    typedef std::map<COutPoint, masternode_info_t> info_map_t;
+    typedef std::shared_ptr<const info_map_t> info_map_ptr_t;
+    typedef std::unordered_multimap<CKeyID, COutPoint, SaltedKeyIDHasher> key_index_t;
+    typedef std::shared_ptr<const key_index_t> key_index_ptr_t;
+
+    /// Outpoints ordered by score for one block hash and min protocol, best first, and their ranks
+    struct masternode_ranks_t {
+        std::vector<COutPoint> vecOutpoints;
+        std::unordered_map<COutPoint, int, SaltedOutpointHasher> mapRanks;
+    };
+    typedef std::shared_ptr<const masternode_ranks_t> masternode_ranks_ptr_t;
 
 private:
     static const std::string SERIALIZATION_VERSION_STRING;
@@ -39,6 +96,9 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    static const int INFO_SNAPSHOT_SHARDS           = 16;
+    static const int RANK_CACHE_SIZE                = 20;
+    static const size_t PING_BATCH_SIZE             = 256;
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -48,6 +108,39 @@ private:
 
     // map to hold all MNs
     std::map<COutPoint, CMasternode> mapMasternodes;
+
+    // Read-only copies of the masternode_info_t of every entry in mapMasternodes,
+    // split into shards by outpoint. Shards are never modified, only replaced
+    // (while holding cs), so lookups don't need cs at all and never wait for
+    // list maintenance; cs_infoSnapshot is only held to copy a shard pointer.
+    mutable CCriticalSection cs_infoSnapshot;
+    info_map_ptr_t vInfoSnapshot[INFO_SNAPSHOT_SHARDS];
+    // Outpoints in the snapshot by pubKeyMasternode and by pubKeyCollateralAddress
+    // (payees are always P2PKH to it). Several entries can share a key.
+    // Split into shards by key and replaced like the info shards, but only
+    // the shards of the keys an update adds or removes are copied.
+    key_index_ptr_t vIndexByPubKey[INFO_SNAPSHOT_SHARDS];
+    key_index_ptr_t vIndexByCollateral[INFO_SNAPSHOT_SHARDS];
+
+    // Ranks of the most recently asked for (block hash, min protocol) pairs.
+    // A score only depends on the outpoint, nCollateralMinConfBlockHash and the
+    // block hash, so this is cleared (while holding cs) when entries are added,
+    // removed or updated from a new broadcast. Hits only take cs_rankCache.
+    CCriticalSection cs_rankCache;
+    CacheMap<std::pair<uint256, int>, masternode_ranks_ptr_t> mapRankCache;
+
+    // Payment order of the list, (last paid block, outpoint) of every entry with
+    // the oldest payment first. Kept in step with mapMasternodes by UpdatePaymentQueue.
+    std::set<std::pair<int, COutPoint> > setPaymentQueue;
+    std::map<COutPoint, int> mapPaymentQueueLastPaid;
+    // Collateral heights are looked up once (that needs cs_main) instead of on every
+    // payment queue scan. Spent or unknown collaterals are retried on the next scan.
+    // All of them are looked up again once a tip doesn't extend the one seen last,
+    // nCollateralHeightEpoch then drops lookups that were still running.
+    std::map<COutPoint, int> mapCollateralHeight;
+    std::set<COutPoint> setCollateralHeightUnknown;
+    const CBlockIndex* pindexCollateralHeightTip;
+    int nCollateralHeightEpoch;
     // who's asked for the Masternode list and the last time
     std::map<CService, int64_t> mAskedUsForMasternodeList;
     // who we asked for the Masternode list and the last time
@@ -65,6 +158,13 @@ private:
     std::map<CService, std::pair<int64_t, std::set<uint256> > > mapPendingMNB;
     std::map<CService, std::pair<int64_t, CMasternodeVerification> > mapPendingMNV;
     CCriticalSection cs_mapPendingMNV;
+    // Pings waiting to be processed in a batch, only the newest one of each masternode
+    // is kept. Protected by cs, processed with cs_main taken once per batch.
+    std::map<COutPoint, CPendingMasternodePing> mapPendingPings;
+    // Peers which sent a ping with a bad signature that lost against another queued
+    // one, penalized with the next batch since that takes cs_main
+    std::vector<std::pair<NodeId, int> > vecPendingPingMisbehaving;
+    CMasternodePingQueueStats pingQueueStats;
 
     /// Set when masternodes are added, cleared when CGovernanceManager is notified
     bool fMasternodesAdded;
@@ -81,12 +181,34 @@ private:
     CMasternode* Find(const COutPoint& outpoint);
 
     bool GetMasternodeScores(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol = 0);
+    bool GetMasternodeRanks(const uint256& nBlockHash, int nMinProtocol, masternode_ranks_ptr_t& pRanksRet);
+    void ClearRankCache();
+
+    /// Move an entry to its place in the payment queue, or rebuild the queue. Must be called while holding cs
+    void UpdatePaymentQueue(const COutPoint& outpoint);
+    void UpdatePaymentQueue();
+    /// Look up the collateral heights not known yet. Must be called without holding cs
+    void UpdateCollateralHeights();
+    /// Forget the collateral heights, they are looked up again on the next scan. Must be called while holding cs
+    void InvalidateCollateralHeights();
 
     void SyncSingle(CNode* pnode, const COutPoint& outpoint, CConnman& connman);
     void SyncAll(CNode* pnode, CConnman& connman);
 
     void PushDsegInvs(CNode* pnode, const CMasternode& mn);
 
+    static int GetInfoSnapshotShard(const COutPoint& outpoint);
+    static int GetKeyIndexShard(const CKeyID& keyID);
+    info_map_ptr_t GetInfoSnapshot(const COutPoint& outpoint) const;
+    std::vector<info_map_ptr_t> GetInfoSnapshot() const;
+    bool GetMasternodeInfo(const CKeyID& keyID, bool fCollateral, masternode_info_t& mnInfoRet);
+    /// Republish the snapshot of a single entry, of some entries, or of the whole list. Must be called while holding cs
+    void UpdateInfoSnapshot(const COutPoint& outpoint);
+    void UpdateInfoSnapshot(const std::set<COutPoint>& setOutpoints);
+    void UpdateInfoSnapshot();
+    /// Replace the shard of keyID in vIndex by a copy with outpoint added or removed
+    static void UpdateKeyIndex(key_index_ptr_t* vIndex, const CKeyID& keyID, const COutPoint& outpoint, bool fAdd);
+
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, std::pair<int64_t, CMasternodeBroadcast> > mapSeenMasternodeBroadcast;
@@ -126,12 +248,19 @@ public:
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
+        if(ser_action.ForRead()) {
+            UpdateInfoSnapshot();
+            ClearRankCache();
+            UpdatePaymentQueue();
+        }
     }
 
     CMasternodeMan();
 
     /// Add an entry
     bool Add(CMasternode &mn);
+    /// Remove an entry
+    bool Remove(const COutPoint& outpoint);
 
     /// Ask (source) node for mnb
     void AskForMN(CNode *pnode, const COutPoint& outpoint, CConnman& connman);
@@ -166,6 +295,7 @@ public:
 
     /// Versions of Find that are safe to use from outside the class
     bool Get(const COutPoint& outpoint, CMasternode& masternodeRet);
+    /// Has and GetMasternodeInfo read the snapshot and don't take cs
     bool Has(const COutPoint& outpoint);
 
     bool GetMasternodeInfo(const COutPoint& outpoint, masternode_info_t& mnInfoRet);
@@ -188,6 +318,11 @@ public:
     void ProcessMasternodeConnections(CConnman& connman);
     std::pair<CService, std::set<uint256> > PopScheduledMnbRequestConnection();
     void ProcessPendingMnbRequests(CConnman& connman);
+    /// Queue a ping for the next batch, returns true once the batch is full
+    bool AddPendingPing(const CMasternodePing& mnp, NodeId nodeId);
+    /// Check and apply all queued pings, holding cs_main once for the whole batch
+    void ProcessPendingPings(CConnman& connman);
+    CMasternodePingQueueStats GetPingQueueStats();
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
 
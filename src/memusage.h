@@ -119,6 +119,39 @@ static inline size_t IncrementalDynamicUsage(const std::map<X, Y, Z>& m)
     return MallocUsage(sizeof(stl_tree_node<std::pair<const X, Y> >));
 }
 
+// Maps including the heap memory owned by their values: containers, or objects
+// which account for their own memory in a DynamicMemoryUsage() method
+
+template<typename X, typename Y, typename Z>
+static inline size_t RecursiveDynamicUsage(const std::map<X, Y, Z>& m)
+{
+    size_t nUsage = DynamicUsage(m);
+    for (const auto& pair : m) {
+        nUsage += pair.second.DynamicMemoryUsage();
+    }
+    return nUsage;
+}
+
+template<typename X, typename Y, typename Z>
+static inline size_t RecursiveDynamicUsage(const std::map<X, std::vector<Y>, Z>& m)
+{
+    size_t nUsage = DynamicUsage(m);
+    for (const auto& pair : m) {
+        nUsage += DynamicUsage(pair.second);
+    }
+    return nUsage;
+}
+
+template<typename X, typename Y, typename Z, typename W>
+static inline size_t RecursiveDynamicUsage(const std::map<X, std::set<Y, W>, Z>& m)
+{
+    size_t nUsage = DynamicUsage(m);
+    for (const auto& pair : m) {
+        nUsage += DynamicUsage(pair.second);
+    }
+    return nUsage;
+}
+
 // indirectmap has underlying map with pointer as key
 
 template<typename X, typename Y>
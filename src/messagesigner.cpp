@@ -3,12 +3,123 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "base58.h"
+#include "cuckoocache.h"
 #include "hash.h"
 #include "validation.h" // For strMessageMagic
 #include "messagesigner.h"
+#include "random.h"
+#include "script/sigcache.h" // For MAX_MAX_SIG_CACHE_SIZE
 #include "tinyformat.h"
+#include "util.h"
 #include "utilstrencodings.h"
 
+#include <atomic>
+
+#include <boost/thread.hpp>
+
+namespace {
+
+/**
+ * Entries are nonced hashes already, same as in script/sigcache.cpp,
+ * so they are used as the set hashes directly.
+ */
+class MessageSignatureCacheHasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        static_assert(hash_select <8, "MessageSignatureCacheHasher only has 8 hashes available.");
+        uint32_t u;
+        std::memcpy(&u, key.begin()+4*hash_select, 4);
+        return u;
+    }
+};
+
+/**
+ * Cache of valid hash signatures. Masternode broadcasts and pings, governance
+ * and InstantSend votes and masternode verifications are relayed by every peer,
+ * so the same signature is usually seen many times.
+ */
+class CMessageSignatureCache
+{
+private:
+    //! Entries are SHA256(nonce || hash || key id || signature)
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, MessageSignatureCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_sigcache;
+    //! Caching is off until setup_bytes() is called
+    std::atomic<size_t> nElements;
+    std::atomic<uint64_t> nLookups;
+    std::atomic<uint64_t> nHits;
+
+public:
+    CMessageSignatureCache() : nElements(0), nLookups(0), nHits(0)
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    bool IsEnabled() const { return nElements != 0; }
+
+    void ComputeEntry(uint256& entry, const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig) const
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(keyID.begin(), keyID.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        bool fHit;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+            fHit = setValid.contains(entry, false);
+        }
+        nLookups++;
+        if (fHit) nHits++;
+        return fHit;
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        setValid.insert(entry);
+    }
+
+    size_t setup_bytes(size_t n)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        // the cuckoo cache never gets smaller than two elements, zero bytes turns caching off
+        nElements = n == 0 ? 0 : setValid.setup_bytes(n);
+        return nElements;
+    }
+
+    CMessageSignatureCacheStats GetStats() const
+    {
+        CMessageSignatureCacheStats stats;
+        stats.nElements = nElements;
+        stats.nLookups = nLookups;
+        stats.nHits = nHits;
+        return stats;
+    }
+};
+
+static CMessageSignatureCache messageSignatureCache;
+}
+
+// To be called once in AppInit2/TestingSetup, next to InitSignatureCache
+void InitMessageSignatureCache()
+{
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, GetArg("-maxmsgsigcachesize", DEFAULT_MAX_MSG_SIG_CACHE_SIZE)), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = messageSignatureCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for message signature cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+}
+
+CMessageSignatureCacheStats GetMessageSignatureCacheStats()
+{
+    return messageSignatureCache.GetStats();
+}
+
 bool CMessageSigner::GetKeysFromSecret(const std::string& strSecret, CKey& keyRet, CPubKey& pubkeyRet)
 {
     CBitcoinSecret vchSecret;
@@ -56,6 +167,13 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey& pubkey, const s
 
 bool CHashSigner::VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
 {
+    uint256 entry;
+    bool fCache = messageSignatureCache.IsEnabled();
+    if(fCache) {
+        messageSignatureCache.ComputeEntry(entry, hash, keyID, vchSig);
+        if(messageSignatureCache.Get(entry)) return true;
+    }
+
     CPubKey pubkeyFromSig;
     if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
         strErrorRet = "Error recovering public key.";
@@ -69,5 +187,7 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CKeyID& keyID, const std
         return false;
     }
 
+    if(fCache) messageSignatureCache.Set(entry);
+
     return true;
 }
@@ -7,6 +7,9 @@
 
 #include "key.h"
 
+//! Default size of the masternode message signature cache in MiB
+static const unsigned int DEFAULT_MAX_MSG_SIG_CACHE_SIZE = 8;
+
 /** Helper class for signing messages and checking their signatures
  */
 class CMessageSigner
@@ -35,4 +38,16 @@ public:
     static bool VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
 };
 
+/** Hit statistics of the message signature cache */
+struct CMessageSignatureCacheStats
+{
+    size_t nElements;
+    uint64_t nLookups;
+    uint64_t nHits;
+};
+
+/// Set up the cache of valid hash signatures, verification is uncached until this is called
+void InitMessageSignatureCache();
+CMessageSignatureCacheStats GetMessageSignatureCacheStats();
+
 #endif
@@ -30,6 +30,7 @@
 #include "validationinterface.h"
 
 #include <algorithm>
+#include <atomic>
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <queue>
@@ -595,10 +596,32 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
 
 // KeplerMiner
 
-static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainparams)
+struct CMinerCounters
+{
+    std::atomic<int> nThreads;
+    std::atomic<int64_t> nStartTime;
+    std::atomic<uint64_t> nHashesDone;
+    std::atomic<uint64_t> nBlocksAccepted;
+    std::atomic<uint64_t> nBlocksStale;
+};
+static CMinerCounters minerCounters[NUM_ALGOS];
+
+CMinerStats GetMinerStats(int algo)
+{
+    const CMinerCounters& counters = minerCounters[algo];
+    CMinerStats stats;
+    stats.nThreads = counters.nThreads;
+    stats.nStartTime = counters.nStartTime;
+    stats.nHashesDone = counters.nHashesDone;
+    stats.nBlocksAccepted = counters.nBlocksAccepted;
+    stats.nBlocksStale = counters.nBlocksStale;
+    return stats;
+}
+
+static bool ProcessBlockFound(const CBlock* pblock, const uint256& hashPoW, const CChainParams& chainparams)
 {
     std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(*pblock);
-    LogPrintf("%s\n", pblock->ToString());
+    LogPrintf("%s\n", pblock->ToString(hashPoW));
     //LogPrintf("generated %s\n", FormatMoney(pblock->vtx[0].vout[0].nValue));
 
     // Found a solution
@@ -611,7 +634,8 @@ static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainpar
     // Inform about the new block
     GetMainSignals().BlockFound(pblock->GetHash());
 
-    // Process this block the same as if we had received it from another node
+    // Process this block the same as if we had received it from another node, without hashing it again
+    CachePoWHash(pblock->GetHash(), hashPoW);
     //if (!ProcessNewBlock(chainparams, pblock, true, NULL, NULL))   
     if (!ProcessNewBlock(chainparams, shared_pblock, true, NULL))
         return error("ProcessBlockFound -- ProcessNewBlock() failed, block not accepted");
@@ -620,14 +644,29 @@ static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainpar
 }
 
 // ***TODO*** that part changed in bitcoin, we are using a mix with old one here for now
-void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
+void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman, int algo, int nThread, int nThreads)
 {
-    LogPrintf("KeplerMiner -- started\n");
+    LogPrintf("KeplerMiner -- started %s thread %d/%d\n", GetAlgoName(algo, GetTime()), nThread + 1, nThreads);
     SetThreadPriority(THREAD_PRIORITY_LOWEST);
     RenameThread("kepler-miner");
 
     unsigned int nExtraNonce = 0;
 
+    // Threads of one algo all start from the same template, so each of them
+    // scans its own slice of the nonce space. The search loop below only checks
+    // the slice end every 256 nonces, so slices are kept 256-aligned.
+    const uint32_t nNonceRange = (0xffff0000 / nThreads) & ~0xffu;
+    const uint32_t nNonceBegin = nNonceRange * nThread;
+    const uint32_t nNonceEnd = nNonceBegin + nNonceRange;
+
+    // Hash once up front so this thread's PoW scratch memory is allocated
+    // before the search loop starts
+    {
+        CBlockHeader header;
+        header.SetAlgo(algo);
+        header.GetPoWHash(algo);
+    }
+
     boost::shared_ptr<CReserveScript> coinbaseScript;
     GetMainSignals().ScriptForMining(coinbaseScript);
 
@@ -659,7 +698,7 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
             if(!pindexPrev) break;
 
             //std::unique_ptr<CBlockTemplate> pblocktemplate(CreateNewBlock(coinbaseScript->reserveScript, miningAlgo));
-            std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler(chainparams).CreateNewBlock(coinbaseScript->reserveScript, miningAlgo));
+            std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler(chainparams).CreateNewBlock(coinbaseScript->reserveScript, algo));
             if (!pblocktemplate.get())
             {
                 LogPrintf("KeplerMiner -- Keypool ran out, please call keypoolrefill before restarting the mining thread\n");
@@ -667,6 +706,7 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
             }
             CBlock *pblock = &pblocktemplate->block;
             IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
+            pblock->nNonce = nNonceBegin;
 
             LogPrintf("KeplerMiner -- Running miner with %u transactions in block (%u bytes)\n", pblock->vtx.size(),
                 ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
@@ -683,13 +723,16 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
                 uint256 hash;
                 while (true)
                 {
-                    hash = pblock->GetPoWHash(miningAlgo);
+                    hash = pblock->GetPoWHash(algo);
                     if (UintToArith256(hash) <= hashTarget)
                     {
                         // Found a solution
                         SetThreadPriority(THREAD_PRIORITY_NORMAL);
                         LogPrintf("KeplerMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
-                        ProcessBlockFound(pblock, chainparams);
+                        if (ProcessBlockFound(pblock, hash, chainparams))
+                            minerCounters[algo].nBlocksAccepted++;
+                        else
+                            minerCounters[algo].nBlocksStale++;
                         SetThreadPriority(THREAD_PRIORITY_LOWEST);
                         coinbaseScript->KeepScript();
 
@@ -705,13 +748,14 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
                     if ((pblock->nNonce & 0xFF) == 0)
                         break;
                 }
+                minerCounters[algo].nHashesDone += nHashesDone;
 
                 // Check for stop or if block needs to be rebuilt
                 boost::this_thread::interruption_point();
                 // Regtest mode doesn't require peers
                 if (connman.GetNodeCount(CConnman::CONNECTIONS_ALL) == 0 && chainparams.MiningRequiresPeers())
                     break;
-                if (pblock->nNonce >= 0xffff0000)
+                if (pblock->nNonce >= nNonceEnd)
                     break;
                 if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60)
                     break;
@@ -742,26 +786,41 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman)
     }
 }
 
-void GenerateBitcoins(bool fGenerate, int nThreads, const CChainParams& chainparams, CConnman& connman)
+void GenerateBitcoins(bool fGenerate, int nThreads, int algo, const CChainParams& chainparams, CConnman& connman)
 {
-    static boost::thread_group* minerThreads = NULL;
+    static boost::thread_group* minerThreads[NUM_ALGOS] = {};
+
+    if (algo < 0)
+    {
+        for (int i = 0; i < NUM_ALGOS; i++)
+            GenerateBitcoins(fGenerate, nThreads, i, chainparams, connman);
+        return;
+    }
 
     if (nThreads < 0)
         nThreads = GetNumCores();
 
-    if (minerThreads != NULL)
+    if (minerThreads[algo] != NULL)
     {
-        minerThreads->interrupt_all();
-        delete minerThreads;
-        minerThreads = NULL;
+        minerThreads[algo]->interrupt_all();
+        delete minerThreads[algo];
+        minerThreads[algo] = NULL;
+        minerCounters[algo].nThreads = 0;
     }
 
     if (nThreads == 0 || !fGenerate)
         return;
 
-    minerThreads = new boost::thread_group();
+    CMinerCounters& counters = minerCounters[algo];
+    counters.nThreads = nThreads;
+    counters.nStartTime = GetTimeMillis();
+    counters.nHashesDone = 0;
+    counters.nBlocksAccepted = 0;
+    counters.nBlocksStale = 0;
+
+    minerThreads[algo] = new boost::thread_group();
     for (int i = 0; i < nThreads; i++)
-        minerThreads->create_thread(boost::bind(&BitcoinMiner, boost::cref(chainparams), boost::ref(connman)));
+        minerThreads[algo]->create_thread(boost::bind(&BitcoinMiner, boost::cref(chainparams), boost::ref(connman), algo, i, nThreads));
 }
 
 
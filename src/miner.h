@@ -215,7 +215,24 @@ private:
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 
-/** Run the miner threads */
-void GenerateBitcoins(bool fGenerate, int nThreads, const CChainParams& chainparams, CConnman& connman);
+/** Internal miner statistics for one algo, reset whenever its threads are restarted */
+struct CMinerStats
+{
+    int nThreads;
+    int64_t nStartTime;         //! GetTimeMillis() when the threads were started
+    uint64_t nHashesDone;
+    uint64_t nBlocksAccepted;
+    uint64_t nBlocksStale;      //! found but not accepted, usually because the tip moved
+
+    double GetHashesPerSec(int64_t nNow) const
+    {
+        return (nThreads && nNow > nStartTime) ? nHashesDone * 1000.0 / (nNow - nStartTime) : 0;
+    }
+};
+
+/** Run the miner threads for algo, or for every algo if algo is -1 */
+void GenerateBitcoins(bool fGenerate, int nThreads, int algo, const CChainParams& chainparams, CConnman& connman);
+/** Snapshot of the internal miner statistics for algo */
+CMinerStats GetMinerStats(int algo);
 
 #endif // BITCOIN_MINER_H
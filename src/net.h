@@ -23,6 +23,7 @@
 
 #include <atomic>
 #include <deque>
+#include <set>
 #include <stdint.h>
 #include <thread>
 #include <memory>
@@ -88,6 +89,12 @@ static const uint64_t MAX_UPLOAD_TIMEFRAME = 60 * 60 * 24;
 static const bool DEFAULT_BLOCKSONLY = false;
 
 static const bool DEFAULT_FORCEDNSSEED = false;
+/** -socketevents default */
+#ifdef USE_EPOLL
+static const char* const DEFAULT_SOCKETEVENTS = "epoll";
+#else
+static const char* const DEFAULT_SOCKETEVENTS = "select";
+#endif
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
@@ -135,6 +142,11 @@ public:
         CONNECTIONS_ALL = (CONNECTIONS_IN | CONNECTIONS_OUT),
     };
 
+    enum SocketEventsMode {
+        SOCKETEVENTS_SELECT = 0,
+        SOCKETEVENTS_EPOLL = 1,
+    };
+
     struct Options
     {
         ServiceFlags nLocalServices = NODE_NONE;
@@ -149,6 +161,7 @@ public:
         unsigned int nReceiveFloodSize = 0;
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
+        SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
     };
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
@@ -394,6 +407,20 @@ public:
     unsigned int GetReceiveFloodSize() const;
 
     void WakeMessageHandler();
+    //! Update the events pnode waits for with epoll, after its send queue or fPauseRecv changed
+    void UpdateSocketEvents(CNode* pnode);
+
+protected:
+    // Also used by the socket handler benchmark on simulated peers
+    bool InitSocketEvents(SocketEventsMode mode, std::string& strError);
+    //! One pass of the socket handler: wait up to 50ms for socket activity and service the ready sockets
+    void SocketHandler();
+
+    std::vector<CNode*> vNodes;
+    mutable CCriticalSection cs_vNodes;
+    unsigned int nReceiveFloodSize;
+    CThreadInterrupt interruptNet;
+
 private:
     struct ListenSocket {
         SOCKET socket;
@@ -407,6 +434,14 @@ private:
     void ThreadOpenConnections();
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
+    //! Whether hSocket can be serviced by the socket handler in the active -socketevents mode
+    bool IsUsableSocket(SOCKET hSocket) const;
+#ifdef USE_EPOLL
+    void SocketHandlerEpoll();
+#endif
+    //! Receive from and send to the socket of pnode, returns false if it was closed already
+    bool ServiceSocket(CNode* pnode, bool recvSet, bool sendSet, bool errorSet);
+    void InactivityCheck(CNode* pnode);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
     void ThreadOpenMasternodeConnections();
@@ -462,9 +497,13 @@ private:
     CCriticalSection cs_vWhitelistedRange;
 
     unsigned int nSendBufferMaxSize;
-    unsigned int nReceiveFloodSize;
 
     std::vector<ListenSocket> vhListenSocket;
+    SocketEventsMode socketEventsMode;
+    //! epoll instance of the socket handler, -1 unless socketEventsMode is SOCKETEVENTS_EPOLL
+    int epollfd;
+    //! last time the epoll socket handler checked all nodes for inactivity
+    int64_t nTimeLastInactivityCheck;
     std::atomic<bool> fNetworkActive;
     banmap_t setBanned;
     CCriticalSection cs_setBanned;
@@ -477,9 +516,7 @@ private:
     CCriticalSection cs_vAddedNodes;
     std::vector<CService> vPendingMasternodes;
     CCriticalSection cs_vPendingMasternodes;
-    std::vector<CNode*> vNodes;
     std::list<CNode*> vNodesDisconnected;
-    mutable CCriticalSection cs_vNodes;
     std::atomic<NodeId> nLastNodeId;
 
     /** Services this instance offers */
@@ -508,8 +545,6 @@ private:
     std::mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc;
 
-    CThreadInterrupt interruptNet;
-
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
@@ -680,6 +715,7 @@ public:
     std::atomic<ServiceFlags> nServices;
     ServiceFlags nServicesExpected;
     SOCKET hSocket;
+    int nEpollEvents; // events hSocket is registered for with epoll, -1 if it is not registered
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
@@ -2912,6 +2912,7 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
             return false;
 
         std::list<CNetMessage> msgs;
+        bool fResumeRecv;
         {
             LOCK(pfrom->cs_vProcessMsg);
             if (pfrom->vProcessMsg.empty())
@@ -2919,9 +2920,12 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
             // Just take one message
             msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
             pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+            fResumeRecv = pfrom->fPauseRecv && pfrom->nProcessQueueSize <= connman.GetReceiveFloodSize();
             pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman.GetReceiveFloodSize();
             fMoreWork = !pfrom->vProcessMsg.empty();
         }
+        if (fResumeRecv)
+            connman.UpdateSocketEvents(pfrom);
         CNetMessage& msg(msgs.front());
 
         msg.SetVersion(pfrom->GetRecvVersion());
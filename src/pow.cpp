@@ -7,9 +7,11 @@
 #include "pow.h"
 
 #include "arith_uint256.h"
+#include "cachemap.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "primitives/block.h"
+#include "sync.h"
 #include "uint256.h"
 #include "util.h"
 
@@ -33,8 +35,7 @@ unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHead
     // Go back by what we want to be nAveragingInterval blocks
     for (int i = 0; pindexFirst && i < params.nPoWAveragingInterval - 1; i++)
     {
-        pindexFirst = pindexFirst->pprev;
-        pindexFirst = GetLastBlockIndexForAlgo(pindexFirst, algo);
+        pindexFirst = pindexFirst->pprevAlgo[algo];
         if (pindexFirst == NULL){   
             return nProofOfWorkLimit.GetCompact();
             //LogPrintf("GetNextWorkRequired(%d):   pindexFirst null, returning powLimit  %d \n", algo, i);
@@ -102,29 +103,57 @@ bool CheckProofOfWork(uint256 hash, int algo, unsigned int nBits, const Consensu
     return true;
 }
 
+static CCriticalSection cs_powHashCache;
+static CacheMap<uint256, uint256> powHashCache(POW_HASH_CACHE_SIZE);
+
+bool GetCachedPoWHash(const uint256& hashBlock, uint256& hashPoW)
+{
+    LOCK(cs_powHashCache);
+    if (!powHashCache.Get(hashBlock, hashPoW))
+        return false;
+    // Evict least recently used rather than oldest, blocks served to peers stay cached
+    powHashCache.Touch(hashBlock);
+    return true;
+}
+
+void CachePoWHash(const uint256& hashBlock, const uint256& hashPoW)
+{
+    LOCK(cs_powHashCache);
+    powHashCache.Insert(hashBlock, hashPoW);
+}
+
+uint256 GetBlockPoWHash(const CBlockIndex* pindex)
+{
+    if (pindex->nStatus & BLOCK_HAVE_POWHASH)
+        return pindex->hashPoW;
+    uint256 hashPoW;
+    if (!GetCachedPoWHash(pindex->GetBlockHash(), hashPoW))
+        hashPoW = pindex->GetBlockHeader().GetPoWHash(pindex->GetAlgo());
+    return hashPoW;
+}
+
+bool CPoWCheck::operator()()
+{
+    int algo = header.GetAlgo();
+    // Headers announced by several peers were usually hashed moments ago
+    if (!GetCachedPoWHash(header.GetHash(), *phashPoW))
+        *phashPoW = header.GetPoWHash(algo);
+    return CheckProofOfWork(*phashPoW, algo, header.nBits, *pparams);
+}
+
 // BASED OF MYRIADCOIN
 arith_uint256 GetPrevWorkForAlgoWithDecay(const CBlockIndex& block, int algo)
 {
-    int nDistance = 0;
-    arith_uint256 nWork;
-    const CBlockIndex* pindex = &block;
-    while (pindex != NULL)
-    {
-        if (nDistance > 100)
-        {
-            return arith_uint256(0);
-        }
-        if (pindex->GetAlgo() == algo)
-        {
-            arith_uint256 nWork = GetBlockProofBase(*pindex);
-            nWork *= (100 - nDistance);
-            nWork /= 100;
-            return nWork;
-        }
-        pindex = pindex->pprev;
-        nDistance++;
-    }
-    return arith_uint256(0);
+    const CBlockIndex* pindex = GetLastBlockIndexForAlgo(&block, algo);
+    if (pindex == NULL)
+        return arith_uint256(0);
+    int nDistance = block.nHeight - pindex->nHeight;
+    if (nDistance > 100)
+        return arith_uint256(0);
+    arith_uint256 nWork = GetBlockProofBase(*pindex);
+    nWork *= (100 - nDistance);
+    nWork /= 100;
+    return nWork;
 }
 
 
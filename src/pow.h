@@ -8,11 +8,11 @@
 #define BITCOIN_POW_H
 
 #include "consensus/params.h"
+#include "primitives/block.h"
 
 #include <stdint.h>
 #include <arith_uint256.h>
 
-class CBlockHeader;
 class CBlockIndex;
 class uint256;
 
@@ -21,9 +21,44 @@ unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHead
 
 /** Check whether a block hash satisfies the proof-of-work requirement specified by nBits */
 bool CheckProofOfWork(uint256 hash, int algo, unsigned int nBits, const Consensus::Params&);
+
+/** Number of recently validated PoW hashes kept, see GetCachedPoWHash */
+static const unsigned int POW_HASH_CACHE_SIZE = 10000;
+/** Look up the PoW hash of a header that recently passed its PoW check, by block hash */
+bool GetCachedPoWHash(const uint256& hashBlock, uint256& hashPoW);
+/** Remember the PoW hash of a header that passed its PoW check */
+void CachePoWHash(const uint256& hashBlock, const uint256& hashPoW);
+/** PoW hash of an index entry, from the entry or the cache, computed only if neither has it */
+uint256 GetBlockPoWHash(const CBlockIndex* pindex);
 arith_uint256 GetBlockProofBase(const CBlockIndex& block);
 arith_uint256 GetBlockProof(const CBlockIndex& block);
 /** Return the time it would take to redo the work difference between from and to, assuming the current hashrate corresponds to the difficulty at tip, in seconds. */
 int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& from, const CBlockIndex& tip, const Consensus::Params&);
 
+/**
+ * Closure representing one header whose PoW hash has to be computed and checked
+ * against its target. The computed hash is stored in *phashPoW, so callers can
+ * reuse it after the check queue has finished.
+ */
+class CPoWCheck
+{
+private:
+    CBlockHeader header;
+    uint256* phashPoW;
+    const Consensus::Params* pparams;
+
+public:
+    CPoWCheck(): phashPoW(NULL), pparams(NULL) {}
+    CPoWCheck(const CBlockHeader& headerIn, uint256* phashPoWIn, const Consensus::Params& paramsIn) :
+        header(headerIn), phashPoW(phashPoWIn), pparams(&paramsIn) { }
+
+    bool operator()();
+
+    void swap(CPoWCheck &check) {
+        std::swap(header, check.header);
+        std::swap(phashPoW, check.phashPoW);
+        std::swap(pparams, check.pparams);
+    }
+};
+
 #endif // BITCOIN_POW_H
@@ -27,7 +27,6 @@ uint256 CBlockHeader::GetHash() const
 
 uint256 CBlockHeader::GetPoWHash(int algo) const
 {
-    strprintf("DEBUG: GetPoWHash %d \n",algo);
     switch (algo)
     {
         case ALGO_SLOT1:
@@ -55,14 +54,14 @@ uint256 CBlockHeader::GetPoWHash(int algo) const
     return thash;
 }
 
-std::string CBlock::ToString() const
+std::string CBlock::ToString(const uint256& hashPoW) const
 {
     std::stringstream s;
     s << strprintf("CBlock(hash=%s, ver=0x%08x, pow_algo=%d, pow_hash=%s, hashPrevBlock=%s, hashMerkleRoot=%s, nTime=%u, nBits=%08x, nNonce=%u, vtx=%u)\n",
         GetHash().ToString(),
         nVersion,
         GetAlgo(),
-        GetPoWHash(GetAlgo()).ToString(),
+        hashPoW.ToString(),
         hashPrevBlock.ToString(),
         hashMerkleRoot.ToString(),
         nTime, nBits, nNonce,
@@ -170,7 +170,8 @@ public:
         return block;
     }
 
-    std::string ToString() const;
+    /** The PoW hash is passed in, it's costly to compute and callers usually have it */
+    std::string ToString(const uint256& hashPoW) const;
 };
 
 
@@ -541,6 +541,9 @@ void ThreadCheckPrivateSend(CConnman& connman)
 
             mnodeman.ProcessPendingMnbRequests(connman);
             mnodeman.ProcessPendingMnvRequests(connman);
+            mnodeman.ProcessPendingPings(connman);
+            // pick up payment votes left over from a batch which never filled up
+            mnpayments.ProcessPendingVotes(connman);
 
             // check if we should activate or ping every few minutes,
             // slightly postpone first run to give net thread a chance to connect to some peers
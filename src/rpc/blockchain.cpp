@@ -14,6 +14,7 @@
 #include "instantx.h"
 #include "validation.h"
 #include "policy/policy.h"
+#include "pow.h"
 #include "primitives/transaction.h"
 #include "rpc/server.h"
 #include "streams.h"
@@ -153,7 +154,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("pow_algo_id", algo));
     result.push_back(Pair("pow_algo", GetAlgoName(algo, blockindex->nTime)));
     result.push_back(Pair("difficulty", GetDifficulty(blockindex, algo)));
-    result.push_back(Pair("pow_hash", block.GetPoWHash(block.GetAlgo()).GetHex()));
+    result.push_back(Pair("pow_hash", GetBlockPoWHash(blockindex).GetHex()));
     result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
 
     if (blockindex->pprev)
@@ -135,7 +135,7 @@ UniValue masternode(const JSONRPCRequest& request)
 #endif // ENABLE_WALLET
          strCommand != "list" && strCommand != "list-conf" && strCommand != "count" &&
          strCommand != "debug" && strCommand != "current" && strCommand != "winner" && strCommand != "winners" && strCommand != "genkey" &&
-         strCommand != "connect" && strCommand != "status"))
+         strCommand != "connect" && strCommand != "status" && strCommand != "pingqueue"))
             throw std::runtime_error(
                 "masternode \"command\"...\n"
                 "Set of commands to execute masternode related actions\n"
@@ -153,6 +153,7 @@ UniValue masternode(const JSONRPCRequest& request)
                 "  status       - Print masternode status information\n"
                 "  list         - Print list of all known masternodes (see masternodelist for more info)\n"
                 "  list-conf    - Print masternode.conf in JSON format\n"
+                "  pingqueue    - Print depth and latency of the masternode ping queue\n"
                 "  winner       - Print info on next masternode winner to vote for\n"
                 "  winners      - Print list of masternode winners\n"
                 );
@@ -230,6 +231,22 @@ UniValue masternode(const JSONRPCRequest& request)
                 total, ps, enabled, nCount);
     }
 
+    if (strCommand == "pingqueue")
+    {
+        CMasternodePingQueueStats stats = mnodeman.GetPingQueueStats();
+
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("queued", (uint64_t)stats.nQueued));
+        obj.push_back(Pair("max_queued", (uint64_t)stats.nMaxQueued));
+        obj.push_back(Pair("processed", stats.nProcessed));
+        obj.push_back(Pair("superseded", stats.nSuperseded));
+        obj.push_back(Pair("batches", stats.nBatches));
+        obj.push_back(Pair("avg_latency_us", stats.nProcessed ? stats.nTotalLatency / (int64_t)stats.nProcessed : 0));
+        obj.push_back(Pair("max_latency_us", stats.nMaxLatency));
+
+        return obj;
+    }
+
     if (strCommand == "current" || strCommand == "winner")
     {
         int nCount;
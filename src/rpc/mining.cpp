@@ -243,19 +243,24 @@ UniValue generatetoaddress(const JSONRPCRequest& request)
 UniValue setgenerate(const JSONRPCRequest& request)
 {
     const UniValue& params = request.params;
-    if (request.fHelp || params.size() < 1 || params.size() > 2)
+    if (request.fHelp || params.size() < 1 || params.size() > 3)
         throw std::runtime_error(
-            "setgenerate generate ( genproclimit )\n"
+            "setgenerate generate ( genproclimit \"algo\" )\n"
             "This command is only intended for debug purposes and might cause errors.\n"
             "\nSet 'generate' true or false to turn generation on or off.\n"
             "Generation is limited to 'genproclimit' processors, -1 is unlimited.\n"
+            "Each algo has its own miner threads, see getmininginfo for their statistics.\n"
             //"See the getgenerate call for the current setting.\n"
             "\nArguments:\n"
             "1. generate         (boolean, required) Set to true to turn on generation, false to turn off.\n"
             "2. genproclimit     (numeric, optional) Set the processor limit for when generation is on. Can be -1 for unlimited.\n"
+            "3. \"algo\"           (string, optional) neoscrypt, argon2d, lyra2cz or all. Defaults to -algo when turning\n"
+            "                    generation on and to all when turning it off.\n"
             "\nExamples:\n"
             "\nSet the generation on with a limit of one processor\n"
             + HelpExampleCli("setgenerate", "true 1") +
+            "\nMine every algo with two threads each\n"
+            + HelpExampleCli("setgenerate", "true 2 all") +
             //"\nCheck the setting\n"
             //+ HelpExampleCli("getgenerate", "") +
             "\nTurn off generation\n"
@@ -279,10 +284,18 @@ UniValue setgenerate(const JSONRPCRequest& request)
         if (nGenProcLimit == 0)
             fGenerate = false;
     }
+    int nAlgo = fGenerate ? miningAlgo : -1;
+    if (params.size() > 2 && params[2].get_str() != "all")
+    {
+        if (!GetAlgoByName(params[2].get_str(), nAlgo))
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown algo: " + params[2].get_str());
+    }
+    else if (params.size() > 2)
+        nAlgo = -1;
     //mapArgs // Problems: See bitcoin pull #9243, zcash issue #2132
     //mapMultiArgs["-gen"] = (fGenerate ? "1" : "0");
     //mapMultiArgs ["-genproclimit"] = itostr(nGenProcLimit);
-    GenerateBitcoins(fGenerate, nGenProcLimit, Params(), *g_connman);
+    GenerateBitcoins(fGenerate, nGenProcLimit, nAlgo, Params(), *g_connman);
 
     return NullUniValue;
 }
@@ -305,6 +318,16 @@ UniValue getmininginfo(const JSONRPCRequest& request)
             "  \"difficulty_argon2d\": xxx.xxxxx (numeric) The current difficulty for argon2d\n"
             "  \"difficulty_lyra2cz\": xxx.xxxxx (numeric) The current difficulty for Lyra2CZ\n"
             "  \"errors\": \"...\"            (string) Current errors\n"
+            "  \"hashespersec\": nnn,       (numeric) The hashes per second of the internal miner over all algos\n"
+            "  \"miners\": {                (json object) Internal miner statistics per algo\n"
+            "    \"neoscrypt\": {           (json object) Statistics since the threads of this algo were started\n"
+            "      \"threads\": n,          (numeric) The number of miner threads\n"
+            "      \"hashespersec\": nnn,   (numeric) The hashes per second\n"
+            "      \"accepted\": n,         (numeric) The number of blocks found and accepted\n"
+            "      \"stale\": n             (numeric) The number of blocks found but not accepted\n"
+            "    },\n"
+            "    ...\n"
+            "  },\n"
             "  \"networkhashps\": nnn,      (numeric) The network hashes per second\n"
             "  \"pooledtx\": n              (numeric) The size of the mempool\n"
             "  \"chain\": \"xxxx\",           (string) current network name as defined in BIP70 (main, test, regtest)\n"
@@ -328,6 +351,25 @@ UniValue getmininginfo(const JSONRPCRequest& request)
     obj.push_back(Pair("difficulty_argon2d", (double)GetDifficulty(NULL, ALGO_SLOT2)));
     obj.push_back(Pair("difficulty_lyra2cz", (double)GetDifficulty(NULL, ALGO_SLOT3)));
     obj.push_back(Pair("errors",           GetWarnings("statusbar")));
+
+    int64_t nNow = GetTimeMillis();
+    double dHashesPerSec = 0;
+    UniValue miners(UniValue::VOBJ);
+    for (int algo = 0; algo < NUM_ALGOS; algo++)
+    {
+        CMinerStats stats = GetMinerStats(algo);
+        UniValue miner(UniValue::VOBJ);
+        miner.push_back(Pair("threads",      stats.nThreads));
+        miner.push_back(Pair("hashespersec", stats.GetHashesPerSec(nNow)));
+        miner.push_back(Pair("accepted",     stats.nBlocksAccepted));
+        miner.push_back(Pair("stale",        stats.nBlocksStale));
+        std::string strAlgo = GetAlgoName(algo, GetTime());
+        transform(strAlgo.begin(), strAlgo.end(), strAlgo.begin(), ::tolower);
+        miners.push_back(Pair(strAlgo, miner));
+        dHashesPerSec += stats.GetHashesPerSec(nNow);
+    }
+    obj.push_back(Pair("hashespersec",     dHashesPerSec));
+    obj.push_back(Pair("miners",           miners));
     obj.push_back(Pair("networkhashps",    getnetworkhashps(request)));
     obj.push_back(Pair("pooledtx",         (uint64_t)mempool.size()));
     obj.push_back(Pair("chain",            Params().NetworkIDString()));
@@ -20,7 +20,9 @@
 #include "wallet/walletdb.h"
 #endif
 
+#include "instantx.h"
 #include "masternode-sync.h"
+#include "messagesigner.h"
 #include "spork.h"
 
 #include <stdint.h>
@@ -1128,6 +1130,68 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
     return obj;
 }
 
+UniValue getmessagesigcacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getmessagesigcacheinfo\n"
+            "Returns an object containing information about the cache of verified masternode,\n"
+            "governance and InstantSend message signatures.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"size\": xxxxx,            (numeric) Maximum number of cached signatures\n"
+            "  \"lookups\": xxxxx,         (numeric) Number of signature checks done since startup\n"
+            "  \"hits\": xxxxx,            (numeric) Number of signature checks answered from the cache\n"
+            "  \"hitrate\": x.xxx,         (numeric) Share of signature checks answered from the cache\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmessagesigcacheinfo", "")
+            + HelpExampleRpc("getmessagesigcacheinfo", "")
+        );
+
+    CMessageSignatureCacheStats stats = GetMessageSignatureCacheStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("size", (uint64_t)stats.nElements));
+    obj.push_back(Pair("lookups", stats.nLookups));
+    obj.push_back(Pair("hits", stats.nHits));
+    obj.push_back(Pair("hitrate", stats.nLookups ? (double)stats.nHits / stats.nLookups : 0.0));
+    return obj;
+}
+
+UniValue getinstantsendqueueinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getinstantsendqueueinfo\n"
+            "Returns an object containing information about the queue of InstantSend lock votes\n"
+            "waiting for the InstantSend thread.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"queued\": xxxxx,            (numeric) Number of votes waiting to be processed\n"
+            "  \"max_queued\": xxxxx,        (numeric) Largest number of votes waiting at once since startup\n"
+            "  \"processed\": xxxxx,         (numeric) Number of votes processed since startup\n"
+            "  \"batches\": xxxxx,           (numeric) Number of batches the votes were processed in\n"
+            "  \"finalize_batches\": xxxxx,  (numeric) Number of batches which took cs_main to finalize locks\n"
+            "  \"avg_latency_us\": xxxxx,    (numeric) Average time a vote spent in the queue, in microseconds\n"
+            "  \"max_latency_us\": xxxxx,    (numeric) Longest time a vote spent in the queue, in microseconds\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getinstantsendqueueinfo", "")
+            + HelpExampleRpc("getinstantsendqueueinfo", "")
+        );
+
+    CTxLockVoteQueueStats stats = instantsend.GetVoteQueueStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("queued", (uint64_t)stats.nQueued));
+    obj.push_back(Pair("max_queued", (uint64_t)stats.nMaxQueued));
+    obj.push_back(Pair("processed", stats.nProcessed));
+    obj.push_back(Pair("batches", stats.nBatches));
+    obj.push_back(Pair("finalize_batches", stats.nFinalizeBatches));
+    obj.push_back(Pair("avg_latency_us", stats.nProcessed ? stats.nTotalLatency / (int64_t)stats.nProcessed : 0));
+    obj.push_back(Pair("max_latency_us", stats.nMaxLatency));
+    return obj;
+}
+
 UniValue echo(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -1163,6 +1227,8 @@ static const CRPCCommand commands[] =
     /* Kepler features */
     { "kepler",               "mnsync",                 &mnsync,                 true,  {} },
     { "kepler",               "spork",                  &spork,                  true,  {"value"} },
+    { "kepler",               "getmessagesigcacheinfo", &getmessagesigcacheinfo, true,  {} },
+    { "kepler",               "getinstantsendqueueinfo", &getinstantsendqueueinfo, true, {} },
 
     /* Not shown in help */
     { "hidden",             "setmocktime",            &setmocktime,            true,  {"timestamp"}},
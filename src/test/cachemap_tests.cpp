@@ -133,4 +133,76 @@ BOOST_AUTO_TEST_CASE(cachemap_test)
     BOOST_CHECK(Compare(cmapTest1, mapTest4));
 }
 
+BOOST_AUTO_TEST_CASE(cachemap_touch_test)
+{
+    CacheMap<int,int> cmapTest(3);
+    cmapTest.Insert(1, 1);
+    cmapTest.Insert(2, 2);
+    cmapTest.Insert(3, 3);
+
+    // touching the oldest item makes 2 the next one to be pruned
+    BOOST_CHECK(cmapTest.Touch(1));
+    BOOST_CHECK(!cmapTest.Touch(4));
+    cmapTest.Insert(4, 4);
+    BOOST_CHECK(cmapTest.HasKey(1));
+    BOOST_CHECK(!cmapTest.HasKey(2));
+    BOOST_CHECK(cmapTest.HasKey(3));
+    BOOST_CHECK(cmapTest.HasKey(4));
+
+    // the index still points at the moved item
+    int nValRet = 0;
+    BOOST_CHECK(cmapTest.Get(1, nValRet));
+    BOOST_CHECK(nValRet == 1);
+    cmapTest.Erase(1);
+    BOOST_CHECK(!cmapTest.HasKey(1));
+    BOOST_CHECK(cmapTest.GetSize() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(valueindexedcachemap_test)
+{
+    // create a ValueIndexedCacheMap limited to 10 items
+    ValueIndexedCacheMap<int,int> cmapTest1(10);
+
+    // add 10 items with values 0 and 1
+    for(int i = 0; i < 10; ++i) {
+        BOOST_CHECK(cmapTest1.Insert(i, i % 2) == true);
+    }
+    BOOST_CHECK(cmapTest1.GetSize() == 10);
+
+    // make sure that insert fails to update already existing key
+    BOOST_CHECK(cmapTest1.Insert(0, 1) == false);
+
+    // erase all items with value 1
+    cmapTest1.EraseValue(1);
+    BOOST_CHECK(cmapTest1.GetSize() == 5);
+    for(int i = 0; i < 10; ++i) {
+        BOOST_CHECK(cmapTest1.HasKey(i) == (i % 2 == 0));
+    }
+
+    // erasing a missing value does nothing
+    cmapTest1.EraseValue(1);
+    BOOST_CHECK(cmapTest1.GetSize() == 5);
+
+    // erase a single item, then its value
+    cmapTest1.Erase(0);
+    BOOST_CHECK(cmapTest1.HasKey(0) == false);
+    cmapTest1.EraseValue(0);
+    BOOST_CHECK(cmapTest1.GetSize() == 0);
+
+    // fill past the limit, the pruned items must be gone from the value index too
+    for(int i = 0; i < 15; ++i) {
+        cmapTest1.Insert(i, 2);
+    }
+    BOOST_CHECK(cmapTest1.GetSize() == 10);
+    BOOST_CHECK(cmapTest1.HasKey(4) == false);
+    BOOST_CHECK(cmapTest1.HasKey(5) == true);
+    cmapTest1.Insert(15, 3);
+    BOOST_CHECK(cmapTest1.HasKey(5) == false);
+    cmapTest1.EraseValue(2);
+    BOOST_CHECK(cmapTest1.GetSize() == 1);
+    int nValRet = 0;
+    BOOST_CHECK(cmapTest1.Get(15, nValRet) == true);
+    BOOST_CHECK(nValRet == 3);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -9,6 +9,10 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "crypto/hashargon2d.h"
+#include "crypto/powscratch.h"
+#include "pow.h"
+#include "primitives/block.h"
 #include "utilstrencodings.h"
 #include "test/test_kepler.h"
 #include "test/test_random.h"
@@ -462,4 +466,51 @@ BOOST_AUTO_TEST_CASE(pbkdf2_hmac_sha512_test) {
     BOOST_CHECK(HexStr(k, k + 64) == "8c0511f4c6e597c6ac6315d8f0362e225f3c501495ba23b868c005174dc4ee71115b59f9e60cd9532fa33e0f75aefe30225c583a186cd82bd4daea9724a3d3b8");
 }
 
+BOOST_AUTO_TEST_CASE(pow_scratch_test) {
+    // Hashing in the reused scratch arena must give the same results as allocating per hash
+    for (int i = 0; i < 3; i++) {
+        std::vector<unsigned char> in(80);
+        for (unsigned char& c : in)
+            c = insecure_rand();
+
+        uint256 argonAlloc, argonScratch;
+        argon2d_hash_raw(1, 4096, 1, in.data(), in.size(), in.data(), in.size(), argonAlloc.begin(), 32);
+        argonScratch = HashArgon2d(in.begin(), in.end());
+        BOOST_CHECK(argonAlloc == argonScratch);
+    }
+    BOOST_CHECK(PoWScratch().Size() >= 4096 * 1024);
+}
+
+BOOST_AUTO_TEST_CASE(pow_hash_cache_test) {
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.SetAlgo(ALGO_SLOT3);
+    header.nBits = 0x1e0fffff;
+    header.nNonce = insecure_rand();
+
+    uint256 hash = header.GetPoWHash(ALGO_SLOT3);
+    BOOST_CHECK(header.GetPoWHash(ALGO_SLOT3) == hash);
+    BOOST_CHECK(header.GetPoWHash(ALGO_SLOT1) != hash);
+
+    uint256 hashCached;
+    BOOST_CHECK(!GetCachedPoWHash(header.GetHash(), hashCached));
+    CachePoWHash(header.GetHash(), hash);
+    BOOST_CHECK(GetCachedPoWHash(header.GetHash(), hashCached));
+    BOOST_CHECK(hashCached == hash);
+
+    // A header that keeps being looked up survives a full cache worth of new inserts
+    for (unsigned int i = 0; i < POW_HASH_CACHE_SIZE; i++) {
+        CBlockHeader other = header;
+        other.nNonce = header.nNonce + 1 + i;
+        CachePoWHash(other.GetHash(), uint256());
+        if (i % 1000 == 0)
+            BOOST_CHECK(GetCachedPoWHash(header.GetHash(), hashCached));
+    }
+    BOOST_CHECK(GetCachedPoWHash(header.GetHash(), hashCached));
+    BOOST_CHECK(hashCached == hash);
+    CBlockHeader first = header;
+    first.nNonce = header.nNonce + 1;
+    BOOST_CHECK(!GetCachedPoWHash(first.GetHash(), hashCached));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
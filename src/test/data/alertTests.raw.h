@@ -0,0 +1,163 @@
+namespace raw_tests{
+static unsigned const char alertTests[] = {
+0x41, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 
+0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x51, 0x01, 
+0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
+0x00, 0x00, 0x59, 0x3e, 0x0f, 0x00, 0x00, 0x01, 
+0x00, 0x00, 0x00, 0x0d, 0x41, 0x6c, 0x65, 0x72, 
+0x74, 0x20, 0x63, 0x6f, 0x6d, 0x6d, 0x65, 0x6e, 
+0x74, 0x07, 0x41, 0x6c, 0x65, 0x72, 0x74, 0x20, 
+0x31, 0x00, 0x46, 0x30, 0x44, 0x02, 0x20, 0x74, 
+0x3a, 0x13, 0xe3, 0xd0, 0x47, 0x5b, 0x40, 0x58, 
+0xee, 0xce, 0x76, 0xcd, 0xcc, 0x03, 0x0c, 0xf3, 
+0x87, 0x91, 0x95, 0x7a, 0x8c, 0x88, 0xa4, 0x1d, 
+0xd5, 0x8f, 0x2d, 0x9e, 0x6b, 0xb5, 0xbc, 0x02, 
+0x20, 0x13, 0x17, 0x8c, 0x80, 0xbb, 0x9b, 0xe9, 
+0x69, 0x8c, 0x36, 0xea, 0xa3, 0x53, 0x34, 0x3a, 
+0x94, 0xa7, 0x61, 0x0d, 0x56, 0x89, 0xbf, 0xd5, 
+0xd8, 0xd4, 0x36, 0xd1, 0xe1, 0x17, 0x49, 0x7a, 
+0xf8, 0x63, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x51, 
+0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
+0x00, 0x00, 0x00, 0x59, 0x3e, 0x0f, 0x00, 0x01, 
+0x0f, 0x2f, 0x53, 0x61, 0x74, 0x6f, 0x73, 0x68, 
+0x69, 0x3a, 0x30, 0x2e, 0x31, 0x2e, 0x30, 0x2f, 
+0x01, 0x00, 0x00, 0x00, 0x0d, 0x41, 0x6c, 0x65, 
+0x72, 0x74, 0x20, 0x63, 0x6f, 0x6d, 0x6d, 0x65, 
+0x6e, 0x74, 0x19, 0x41, 0x6c, 0x65, 0x72, 0x74, 
+0x20, 0x31, 0x20, 0x66, 0x6f, 0x72, 0x20, 0x53, 
+0x61, 0x74, 0x6f, 0x73, 0x68, 0x69, 0x20, 0x30, 
+0x2e, 0x31, 0x2e, 0x30, 0x00, 0x47, 0x30, 0x45, 
+0x02, 0x21, 0x00, 0x97, 0xcb, 0x61, 0xfb, 0xe3, 
+0x92, 0x8c, 0xa9, 0x35, 0xa7, 0x11, 0xcd, 0xe2, 
+0x74, 0xc5, 0xcb, 0x56, 0x15, 0xb6, 0x74, 0x94, 
+0x90, 0x2a, 0xb3, 0x04, 0xc2, 0xae, 0x59, 0x5a, 
+0xb6, 0x86, 0xcf, 0x02, 0x20, 0x53, 0x39, 0x9a, 
+0x84, 0x77, 0xf6, 0x2d, 0x74, 0xca, 0xee, 0x65, 
+0xc6, 0xdd, 0x31, 0xcf, 0xe4, 0x7c, 0x67, 0xaa, 
+0x04, 0x92, 0xe3, 0x12, 0xc5, 0x82, 0x6a, 0xaf, 
+0x36, 0xab, 0x36, 0x86, 0x11, 0x7a, 0x01, 0x00, 
+0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 
+0x00, 0x00, 0x80, 0x51, 0x01, 0x00, 0x00, 0x00, 
+0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x59, 
+0x3e, 0x0f, 0x00, 0x02, 0x0f, 0x2f, 0x53, 0x61, 
+0x74, 0x6f, 0x73, 0x68, 0x69, 0x3a, 0x30, 0x2e, 
+0x31, 0x2e, 0x30, 0x2f, 0x0f, 0x2f, 0x53, 0x61, 
+0x74, 0x6f, 0x73, 0x68, 0x69, 0x3a, 0x30, 0x2e, 
+0x32, 0x2e, 0x30, 0x2f, 0x01, 0x00, 0x00, 0x00, 
+0x0d, 0x41, 0x6c, 0x65, 0x72, 0x74, 0x20, 0x63, 
+0x6f, 0x6d, 0x6d, 0x65, 0x6e, 0x74, 0x20, 0x41, 
+0x6c, 0x65, 0x72, 0x74, 0x20, 0x31, 0x20, 0x66, 
+0x6f, 0x72, 0x20, 0x53, 0x61, 0x74, 0x6f, 0x73, 
+0x68, 0x69, 0x20, 0x30, 0x2e, 0x31, 0x2e, 0x30, 
+0x2c, 0x20, 0x30, 0x2e, 0x32, 0x2e, 0x30, 0x00, 
+0x46, 0x30, 0x44, 0x02, 0x20, 0x66, 0xf6, 0xf7, 
+0x15, 0x06, 0xfa, 0x07, 0x08, 0x07, 0xb3, 0xe2, 
+0x79, 0x11, 0xc8, 0xce, 0xfd, 0x09, 0x08, 0x31, 
+0xa9, 0x44, 0x15, 0x39, 0x88, 0x12, 0x30, 0x44, 
+0x76, 0x73, 0xea, 0xf3, 0x24, 0x02, 0x20, 0x56, 
+0x60, 0x1c, 0xc3, 0xa5, 0x6c, 0xc7, 0xb9, 0x3c, 
+0x0c, 0xc8, 0xe3, 0x0d, 0x88, 0x9b, 0x5d, 0x1b, 
+0x03, 0x95, 0x01, 0xa8, 0x80, 0x4e, 0xd5, 0x38, 
+0x25, 0x91, 0x41, 0x4b, 0x6b, 0x96, 0x87, 0x4c, 
+0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 
+0x00, 0x00, 0x00, 0x00, 0x80, 0x51, 0x01, 0x00, 
+0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 
+0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
+0x00, 0x59, 0x3e, 0x0f, 0x00, 0x00, 0x64, 0x00, 
+0x00, 0x00, 0x0d, 0x41, 0x6c, 0x65, 0x72, 0x74, 
+0x20, 0x63, 0x6f, 0x6d, 0x6d, 0x65, 0x6e, 0x74, 
+0x12, 0x41, 0x6c, 0x65, 0x72, 0x74, 0x20, 0x32, 
+0x2c, 0x20, 0x63, 0x61, 0x6e, 0x63, 0x65, 0x6c, 
+0x73, 0x20, 0x31, 0x00, 0x47, 0x30, 0x45, 0x02, 
+0x21, 0x00, 0xaf, 0x04, 0xe4, 0x65, 0x80, 0xf6, 
+0x63, 0xde, 0x80, 0x24, 0xe6, 0x40, 0x66, 0xde, 
+0x3d, 0xee, 0xc3, 0x0a, 0xdb, 0x09, 0x62, 0x29, 
+0x50, 0xbc, 0x68, 0x96, 0x8a, 0x73, 0x2a, 0xea, 
+0xe3, 0x62, 0x02, 0x20, 0x6b, 0x5b, 0x98, 0x75, 
+0x05, 0x91, 0x82, 0x63, 0xce, 0x9d, 0x21, 0x7f, 
+0xef, 0x7a, 0xd8, 0x88, 0x4d, 0xa3, 0xe9, 0x04, 
+0x4c, 0xcf, 0x33, 0x04, 0x6a, 0xbd, 0x60, 0xfb, 
+0x2f, 0x92, 0x38, 0x41, 0x4c, 0x01, 0x00, 0x00, 
+0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
+0x00, 0xbc, 0x51, 0x01, 0x00, 0x00, 0x00, 0x00, 
+0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x59, 0x3e, 
+0x0f, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0x0d, 
+0x41, 0x6c, 0x65, 0x72, 0x74, 0x20, 0x63, 0x6f, 
+0x6d, 0x6d, 0x65, 0x6e, 0x74, 0x12, 0x41, 0x6c, 
+0x65, 0x72, 0x74, 0x20, 0x32, 0x2c, 0x20, 0x63, 
+0x61, 0x6e, 0x63, 0x65, 0x6c, 0x73, 0x20, 0x31, 
+0x00, 0x47, 0x30, 0x45, 0x02, 0x21, 0x00, 0xce, 
+0x4d, 0x7c, 0x07, 0xd4, 0x52, 0x2e, 0x26, 0x5d, 
+0x14, 0xb9, 0x80, 0xc1, 0x6c, 0x1f, 0xce, 0x4d, 
+0x55, 0xd7, 0xaf, 0x02, 0x01, 0x43, 0x6c, 0x50, 
+0xd6, 0x1d, 0x5f, 0x80, 0xcd, 0x56, 0x75, 0x02, 
+0x20, 0x0f, 0x7d, 0x93, 0x73, 0x03, 0xe2, 0x80, 
+0x91, 0xdd, 0x28, 0x75, 0x9f, 0xff, 0x3d, 0x42, 
+0x6a, 0x47, 0x9f, 0x03, 0xd9, 0xa6, 0xca, 0xa5, 
+0xff, 0x2f, 0x14, 0x8e, 0x67, 0xb8, 0x7d, 0x77, 
+0x56, 0x4c, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xbc, 0x51, 
+0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 
+0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x0b, 
+0x00, 0x00, 0x00, 0x16, 0x00, 0x00, 0x00, 0x00, 
+0x64, 0x00, 0x00, 0x00, 0x0d, 0x41, 0x6c, 0x65, 
+0x72, 0x74, 0x20, 0x63, 0x6f, 0x6d, 0x6d, 0x65, 
+0x6e, 0x74, 0x12, 0x41, 0x6c, 0x65, 0x72, 0x74, 
+0x20, 0x32, 0x2c, 0x20, 0x63, 0x61, 0x6e, 0x63, 
+0x65, 0x6c, 0x73, 0x20, 0x31, 0x00, 0x47, 0x30, 
+0x45, 0x02, 0x21, 0x00, 0xa4, 0x00, 0x75, 0xfa, 
+0x6e, 0x3f, 0x15, 0xfb, 0x65, 0x8b, 0x71, 0xb3, 
+0x25, 0x0e, 0xdf, 0xf5, 0x51, 0x67, 0xea, 0x2e, 
+0x66, 0x24, 0xea, 0x36, 0x6d, 0x5c, 0x02, 0xaa, 
+0x9f, 0xdb, 0x82, 0x81, 0x02, 0x20, 0x6f, 0xaf, 
+0xe9, 0xa8, 0xdf, 0x3f, 0xe4, 0xea, 0x5a, 0x73, 
+0xac, 0xce, 0x51, 0x18, 0xb4, 0x07, 0x56, 0xa6, 
+0x07, 0x5c, 0xf4, 0xfb, 0x62, 0xf6, 0xcb, 0xca, 
+0xe3, 0x27, 0xc5, 0x84, 0x28, 0x8c, 0x63, 0x01, 
+0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 
+0x00, 0x00, 0x00, 0xbc, 0x51, 0x01, 0x00, 0x00, 
+0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x01, 
+0x00, 0x00, 0x00, 0x00, 0x0b, 0x00, 0x00, 0x00, 
+0x16, 0x00, 0x00, 0x00, 0x01, 0x0f, 0x2f, 0x53, 
+0x61, 0x74, 0x6f, 0x73, 0x68, 0x69, 0x3a, 0x30, 
+0x2e, 0x31, 0x2e, 0x30, 0x2f, 0x64, 0x00, 0x00, 
+0x00, 0x0d, 0x41, 0x6c, 0x65, 0x72, 0x74, 0x20, 
+0x63, 0x6f, 0x6d, 0x6d, 0x65, 0x6e, 0x74, 0x19, 
+0x41, 0x6c, 0x65, 0x72, 0x74, 0x20, 0x32, 0x20, 
+0x66, 0x6f, 0x72, 0x20, 0x53, 0x61, 0x74, 0x6f, 
+0x73, 0x68, 0x69, 0x20, 0x30, 0x2e, 0x31, 0x2e, 
+0x30, 0x00, 0x46, 0x30, 0x44, 0x02, 0x20, 0x25, 
+0x2f, 0x86, 0x4d, 0x1a, 0x03, 0xc8, 0x61, 0x79, 
+0x29, 0x0e, 0x9d, 0xef, 0x00, 0x0f, 0x29, 0xd1, 
+0xed, 0x70, 0x6e, 0x00, 0xe7, 0x06, 0x8b, 0xee, 
+0x21, 0x32, 0x7a, 0x85, 0x1a, 0xa0, 0x0a, 0x02, 
+0x20, 0x24, 0x6f, 0xd4, 0x3f, 0x5f, 0xc6, 0x89, 
+0xe4, 0xa9, 0x24, 0xc4, 0x21, 0x83, 0x03, 0x97, 
+0xb2, 0x9f, 0x20, 0xa9, 0xed, 0x91, 0x3e, 0x90, 
+0x68, 0x0f, 0xdb, 0x64, 0x4d, 0xb3, 0x59, 0x5b, 
+0xe9, 0x56, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xbc, 0x51, 
+0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 
+0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 
+0x00, 0x00, 0x00, 0x3f, 0x42, 0x0f, 0x00, 0x00, 
+0x64, 0x00, 0x00, 0x00, 0x0d, 0x41, 0x6c, 0x65, 
+0x72, 0x74, 0x20, 0x63, 0x6f, 0x6d, 0x6d, 0x65, 
+0x6e, 0x74, 0x1c, 0x45, 0x76, 0x69, 0x6c, 0x20, 
+0x41, 0x6c, 0x65, 0x72, 0x74, 0x27, 0x3b, 0x20, 
+0x2f, 0x62, 0x69, 0x6e, 0x2f, 0x6c, 0x73, 0x3b, 
+0x20, 0x65, 0x63, 0x68, 0x6f, 0x20, 0x27, 0x00, 
+0x47, 0x30, 0x45, 0x02, 0x21, 0x00, 0xba, 0x7d, 
+0x22, 0x7b, 0xf6, 0x5f, 0xb3, 0xab, 0xc4, 0x18, 
+0x9f, 0x44, 0xc4, 0x1a, 0xcf, 0xfe, 0xc9, 0x54, 
+0x99, 0x04, 0x79, 0x76, 0x76, 0x43, 0x8b, 0x14, 
+0xf0, 0xc1, 0x0b, 0x75, 0xe1, 0x7d, 0x02, 0x20, 
+0x56, 0x61, 0x74, 0x78, 0x3f, 0x62, 0xe3, 0x3a, 
+0x20, 0xfd, 0xd0, 0xa0, 0x3b, 0x1a, 0x2a, 0x1f, 
+0x0b, 0x98, 0xb9, 0xbb, 0xb7, 0xbd, 0xc5, 0x2f, 
+0xe1, 0x78, 0xc6, 0x95, 0x2b, 0x4a, 0x00, 0x88, 
+};};
@@ -0,0 +1,130 @@
+// Copyright (c) 2019 The Kepler developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "flat-database.h"
+
+#include "test/test_kepler.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(flat_database_tests, TestingSetup)
+
+struct CFlatDBTestObject
+{
+    std::vector<int> vecData;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(vecData);
+    }
+
+    void Clear() { vecData.clear(); }
+    void CheckAndRemove() {}
+    std::string ToString() const { return strprintf("%d items", vecData.size()); }
+};
+
+BOOST_AUTO_TEST_CASE(flat_database_roundtrip)
+{
+    // spans several chunks
+    CFlatDBTestObject objSave;
+    for (int i = 0; i < 1000000; i++) {
+        objSave.vecData.push_back(i);
+    }
+
+    CFlatDB<CFlatDBTestObject> flatdb("flattest.dat", "magicFlatTest");
+    BOOST_CHECK(flatdb.Dump(objSave));
+    CFlatDBTestObject objLoad;
+    BOOST_CHECK(flatdb.Load(objLoad));
+    BOOST_CHECK(objLoad.vecData == objSave.vecData);
+
+    // a file for another object type is refused
+    CFlatDB<CFlatDBTestObject> flatdbOther("flattest.dat", "magicOtherTest");
+    CFlatDBTestObject objOther;
+    BOOST_CHECK(!flatdbOther.Load(objOther));
+
+    // flip a byte somewhere in the middle of the chunks
+    boost::filesystem::path path = GetDataDir() / "flattest.dat.0.chunks";
+    FILE* file = fopen(path.string().c_str(), "r+b");
+    BOOST_CHECK(file);
+    fseek(file, 2000000, SEEK_SET);
+    int c = fgetc(file);
+    fseek(file, 2000000, SEEK_SET);
+    fputc(c ^ 1, file);
+    fclose(file);
+    CFlatDBTestObject objCorrupt;
+    BOOST_CHECK(!flatdb.Load(objCorrupt));
+    BOOST_CHECK(objCorrupt.vecData.empty());
+}
+
+BOOST_AUTO_TEST_CASE(flat_database_incremental)
+{
+    CFlatDBTestObject objSave;
+    for (int i = 0; i < 1000000; i++) {
+        objSave.vecData.push_back(i);
+    }
+
+    CFlatDB<CFlatDBTestObject> flatdb("flatincr.dat", "magicFlatTest");
+    boost::filesystem::path pathChunks0 = GetDataDir() / "flatincr.dat.0.chunks";
+    boost::filesystem::path pathChunks1 = GetDataDir() / "flatincr.dat.1.chunks";
+    BOOST_CHECK(flatdb.Dump(objSave));
+    uintmax_t nSizeFull = boost::filesystem::file_size(pathChunks0);
+
+    // a small change only appends the chunks around it
+    objSave.vecData[500000] = -1;
+    objSave.vecData.insert(objSave.vecData.begin() + 1000, 42);
+    BOOST_CHECK(flatdb.Dump(objSave));
+    uintmax_t nSizeIncremental = boost::filesystem::file_size(pathChunks0);
+    BOOST_CHECK(nSizeIncremental > nSizeFull);
+    BOOST_CHECK(nSizeIncremental - nSizeFull < nSizeFull / 10);
+    CFlatDBTestObject objLoad;
+    BOOST_CHECK(flatdb.Load(objLoad));
+    BOOST_CHECK(objLoad.vecData == objSave.vecData);
+
+    // once most of the chunk file is stale a new one replaces it
+    for (int n = 0; n < 4 && !boost::filesystem::exists(pathChunks1); n++) {
+        for (size_t i = 0; i < objSave.vecData.size(); i++) {
+            objSave.vecData[i] = objSave.vecData[i] / 2 + n * 1000000;
+        }
+        BOOST_CHECK(flatdb.Dump(objSave));
+    }
+    BOOST_CHECK(boost::filesystem::exists(pathChunks1));
+    BOOST_CHECK(!boost::filesystem::exists(pathChunks0));
+    BOOST_CHECK(boost::filesystem::file_size(pathChunks1) < nSizeIncremental);
+    CFlatDBTestObject objLoad2;
+    BOOST_CHECK(flatdb.Load(objLoad2));
+    BOOST_CHECK(objLoad2.vecData == objSave.vecData);
+}
+
+BOOST_AUTO_TEST_CASE(flat_database_legacy)
+{
+    CFlatDBTestObject objSave;
+    objSave.vecData.assign(1000, 7);
+
+    // a file in the format without chunked checksums
+    CDataStream ssObj(SER_DISK, CLIENT_VERSION);
+    ssObj << std::string("magicFlatTest");
+    ssObj << FLATDATA(Params().MessageStart());
+    ssObj << objSave;
+    uint256 hash = Hash(ssObj.begin(), ssObj.end());
+    ssObj << hash;
+    boost::filesystem::path path = GetDataDir() / "flatlegacy.dat";
+    CAutoFile fileout(fopen(path.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    fileout << ssObj;
+    fileout.fclose();
+
+    CFlatDB<CFlatDBTestObject> flatdb("flatlegacy.dat", "magicFlatTest");
+    CFlatDBTestObject objLoad;
+    BOOST_CHECK(flatdb.Load(objLoad));
+    BOOST_CHECK(objLoad.vecData == objSave.vecData);
+
+    // and it's upgraded by the next dump
+    BOOST_CHECK(flatdb.Dump(objLoad));
+    CFlatDBTestObject objLoad2;
+    BOOST_CHECK(flatdb.Load(objLoad2));
+    BOOST_CHECK(objLoad2.vecData == objSave.vecData);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
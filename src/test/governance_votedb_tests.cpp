@@ -0,0 +1,67 @@
+// Copyright (c) 2019 The Kepler developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-votedb.h"
+
+#include "test/test_kepler.h"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_votedb_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(governance_votedb_store)
+{
+    uint256 nParentHash = GetRandHash();
+    std::vector<CGovernanceVote> vecVotes;
+    for (int i = 0; i < 10; i++) {
+        vecVotes.push_back(CGovernanceVote(COutPoint(GetRandHash(), i % 2), nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES));
+    }
+
+    // votes added before the database is opened are moved into it
+    CGovernanceObjectVoteFile fileVotes;
+    fileVotes.AddVote(vecVotes[0]);
+    governanceVotes.Init(boost::filesystem::temp_directory_path() / "govvotes", 1 << 20, 2, true);
+    for (const auto& vote : vecVotes) {
+        fileVotes.AddVote(vote);
+    }
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 10);
+
+    // all votes can be read back although only two are held in memory
+    for (const auto& vote : vecVotes) {
+        BOOST_CHECK(fileVotes.HasVote(vote.GetHash()));
+        CGovernanceVoteStore::vote_ptr_t pvote = fileVotes.GetVote(vote.GetHash());
+        BOOST_CHECK(pvote && pvote->GetHash() == vote.GetHash());
+    }
+    BOOST_CHECK_EQUAL(fileVotes.GetVotes().size(), 10U);
+
+    // the index survives serialization, the votes stay in the store
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << fileVotes;
+    CGovernanceObjectVoteFile fileVotes2;
+    ss >> fileVotes2;
+    BOOST_CHECK_EQUAL(fileVotes2.GetVoteCount(), 10);
+    CDataStream ssVote(SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK(fileVotes2.SerializeVoteToStream(vecVotes[9].GetHash(), ssVote));
+
+    fileVotes.RemoveVotesFromMasternode(vecVotes[3].GetMasternodeOutpoint());
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 9);
+    BOOST_CHECK(!governanceVotes.Read(vecVotes[3].GetHash()));
+
+    // only the votes still referenced are kept
+    int nErased = governanceVotes.EraseUnreferenced([&](const uint256& nHash, const CGovernanceVote& vote) {
+        return nHash != vecVotes[5].GetHash();
+    });
+    BOOST_CHECK_EQUAL(nErased, 1);
+    BOOST_CHECK(!governanceVotes.Read(vecVotes[5].GetHash()));
+    BOOST_CHECK(governanceVotes.Read(vecVotes[6].GetHash()));
+
+    fileVotes.RemoveAllVotes();
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 0);
+    BOOST_CHECK(!governanceVotes.Read(vecVotes[6].GetHash()));
+
+    governanceVotes.Close();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,99 @@
+// Copyright (c) 2019 The Kepler developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "activemasternode.h"
+#include "masternode-payments.h"
+#include "masternode-sync.h"
+#include "net_processing.h"
+#include "script/standard.h"
+
+#include "test/test_kepler.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternode_payments_tests, TestingSetup)
+
+static CMasternodePaymentVote MakeVote(const CKey& keyMasternode, const COutPoint& outpoint, int nBlockHeight)
+{
+    CKey keyPayee;
+    keyPayee.MakeNewKey(true);
+    CMasternodePaymentVote vote(outpoint, nBlockHeight, GetScriptForDestination(keyPayee.GetPubKey().GetID()));
+    activeMasternode.keyMasternode = keyMasternode;
+    activeMasternode.pubKeyMasternode = keyMasternode.GetPubKey();
+    BOOST_CHECK(vote.Sign());
+    activeMasternode.keyMasternode = CKey();
+    activeMasternode.pubKeyMasternode = CPubKey();
+    return vote;
+}
+
+BOOST_AUTO_TEST_CASE(mnpayments_pending_votes)
+{
+    // bad signatures only count against the peer once the list is synced
+    masternodeSync.Reset();
+    while (!masternodeSync.IsMasternodeListSynced()) {
+        masternodeSync.SwitchToNextAsset(*connman);
+    }
+
+    CAddress addr(CService(CNetAddr(), Params().GetDefaultPort()), NODE_NONE);
+    CNode nodeGood(1000, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, "", true);
+    CNode nodeBad(1001, NODE_NETWORK, 0, INVALID_SOCKET, addr, 1, 1, "", true);
+    GetNodeSignals().InitializeNode(&nodeGood, *connman);
+    GetNodeSignals().InitializeNode(&nodeBad, *connman);
+
+    CKey key1, key2;
+    key1.MakeNewKey(true);
+    key2.MakeNewKey(true);
+    COutPoint outpoint1(GetRandHash(), 0);
+    COutPoint outpoint2(GetRandHash(), 0);
+    // the block 101 blocks below the vote has to be known, the genesis block here
+    const int nBlockHeight = 101;
+
+    CMasternodePaymentVote voteFirst = MakeVote(key1, outpoint1, nBlockHeight);
+    CMasternodePaymentVote voteSecond = MakeVote(key1, outpoint1, nBlockHeight);
+    CMasternodePaymentVote voteRelayed = MakeVote(key2, outpoint2, nBlockHeight);
+    CMasternodePaymentVote voteWrongKey = MakeVote(key1, outpoint2, nBlockHeight + 1);
+
+    CMasternodePayments mnpaymentsTest;
+    BOOST_CHECK(!mnpaymentsTest.AddPendingVote(CPendingPaymentVote(voteFirst, nodeGood.GetId(), key1.GetPubKey(), 0)));
+    BOOST_CHECK(!mnpaymentsTest.AddPendingVote(CPendingPaymentVote(voteSecond, nodeGood.GetId(), key1.GetPubKey(), 0)));
+    BOOST_CHECK(!mnpaymentsTest.AddPendingVote(CPendingPaymentVote(voteRelayed, nodeGood.GetId(), key2.GetPubKey(), 0)));
+    BOOST_CHECK(!mnpaymentsTest.AddPendingVote(CPendingPaymentVote(voteRelayed, nodeBad.GetId(), key2.GetPubKey(), 0)));
+    BOOST_CHECK(!mnpaymentsTest.AddPendingVote(CPendingPaymentVote(voteWrongKey, nodeBad.GetId(), key2.GetPubKey(), 0)));
+    mnpaymentsTest.ProcessPendingVotes(*connman);
+
+    // votes are applied in the order they were queued, a masternode only gets one vote per block
+    BOOST_CHECK(mnpaymentsTest.HasVerifiedPaymentVote(voteFirst.GetHash()));
+    BOOST_CHECK(!mnpaymentsTest.HasVerifiedPaymentVote(voteSecond.GetHash()));
+    BOOST_CHECK_EQUAL(mnpaymentsTest.GetPayeeBlockHeights(voteFirst.payee, 1, nBlockHeight, nBlockHeight).size(), 1U);
+    BOOST_CHECK(mnpaymentsTest.GetPayeeBlockHeights(voteSecond.payee, 1, nBlockHeight, nBlockHeight).empty());
+
+    // a vote relayed by two peers is only counted once
+    BOOST_CHECK(mnpaymentsTest.HasVerifiedPaymentVote(voteRelayed.GetHash()));
+    BOOST_CHECK_EQUAL(mnpaymentsTest.GetPayeeBlockHeights(voteRelayed.payee, 1, nBlockHeight, nBlockHeight).size(), 1U);
+    BOOST_CHECK(mnpaymentsTest.GetPayeeBlockHeights(voteRelayed.payee, 2, nBlockHeight, nBlockHeight).empty());
+
+    // a bad signature is dropped and counted against the peer which sent it
+    BOOST_CHECK(!mnpaymentsTest.HasVerifiedPaymentVote(voteWrongKey.GetHash()));
+    BOOST_CHECK_EQUAL(mnpaymentsTest.GetVoteCount(), 2);
+    CNodeStateStats stats;
+    BOOST_CHECK(GetNodeStateStats(nodeBad.GetId(), stats));
+    BOOST_CHECK_EQUAL(stats.nMisbehavior, 20);
+    BOOST_CHECK(GetNodeStateStats(nodeGood.GetId(), stats));
+    BOOST_CHECK_EQUAL(stats.nMisbehavior, 0);
+
+    // the queue is flushed once a batch is full
+    for (size_t i = 1; i < MNPAYMENTS_VOTE_CHECK_BATCH_SIZE; i++) {
+        BOOST_CHECK(!mnpaymentsTest.AddPendingVote(CPendingPaymentVote(voteFirst, nodeGood.GetId(), key1.GetPubKey(), 0)));
+    }
+    BOOST_CHECK(mnpaymentsTest.AddPendingVote(CPendingPaymentVote(voteFirst, nodeGood.GetId(), key1.GetPubKey(), 0)));
+    mnpaymentsTest.ProcessPendingVotes(*connman);
+    BOOST_CHECK(mnpaymentsTest.GetPayeeBlockHeights(voteFirst.payee, 2, nBlockHeight, nBlockHeight).empty());
+
+    bool fUpdateConnectionTime = false;
+    GetNodeSignals().FinalizeNode(nodeGood.GetId(), fUpdateConnectionTime);
+    GetNodeSignals().FinalizeNode(nodeBad.GetId(), fUpdateConnectionTime);
+    masternodeSync.Reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,359 @@
+// Copyright (c) 2019 The Kepler developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "clientversion.h"
+#include "masternode-sync.h"
+#include "masternodeman.h"
+#include "messagesigner.h"
+#include "script/standard.h"
+#include "validation.h"
+
+#include "test/test_kepler.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternodeman_tests, BasicTestingSetup)
+
+static CMasternode MakeMasternode(int n)
+{
+    CKey keyCollateral;
+    CKey keyMasternode;
+    keyCollateral.MakeNewKey(true);
+    keyMasternode.MakeNewKey(true);
+    COutPoint outpoint(GetRandHash(), n);
+    CService addr(CNetAddr(), 7000 + n);
+    return CMasternode(addr, outpoint, keyCollateral.GetPubKey(), keyMasternode.GetPubKey(), PROTOCOL_VERSION);
+}
+
+BOOST_AUTO_TEST_CASE(masternodeman_info_snapshot)
+{
+    CMasternodeMan mnman;
+    std::vector<CMasternode> vMasternodes;
+    for (int i = 0; i < 50; i++) {
+        vMasternodes.push_back(MakeMasternode(i));
+        BOOST_CHECK(mnman.Add(vMasternodes.back()));
+    }
+    BOOST_CHECK(!mnman.Add(vMasternodes[0]));
+    BOOST_CHECK_EQUAL(mnman.size(), 50);
+
+    masternode_info_t info;
+    for (const auto& mn : vMasternodes) {
+        BOOST_CHECK(mnman.Has(mn.outpoint));
+
+        BOOST_CHECK(mnman.GetMasternodeInfo(mn.outpoint, info));
+        BOOST_CHECK(info.fInfoValid);
+        BOOST_CHECK(info.outpoint == mn.outpoint);
+
+        BOOST_CHECK(mnman.GetMasternodeInfo(mn.pubKeyMasternode, info));
+        BOOST_CHECK(info.outpoint == mn.outpoint);
+
+        BOOST_CHECK(mnman.GetMasternodeInfo(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()), info));
+        BOOST_CHECK(info.outpoint == mn.outpoint);
+    }
+
+    CMasternode mnUnknown = MakeMasternode(100);
+    BOOST_CHECK(!mnman.Has(mnUnknown.outpoint));
+    BOOST_CHECK(!mnman.GetMasternodeInfo(mnUnknown.outpoint, info));
+    BOOST_CHECK(!mnman.GetMasternodeInfo(mnUnknown.pubKeyMasternode, info));
+
+    // a snapshot is kept in sync with updates to its entry
+    mnman.AllowMixing(vMasternodes[7].outpoint);
+    BOOST_CHECK(mnman.GetMasternodeInfo(vMasternodes[7].outpoint, info));
+    BOOST_CHECK_EQUAL(info.nLastDsq, 1);
+
+    // a PoSe ban shows up right away, not only after the next Check()
+    BOOST_CHECK(mnman.GetMasternodeInfo(vMasternodes[8].outpoint, info));
+    BOOST_CHECK(info.nActiveState != CMasternode::MASTERNODE_POSE_BAN);
+    BOOST_CHECK(mnman.PoSeBan(vMasternodes[8].outpoint));
+    BOOST_CHECK(mnman.GetMasternodeInfo(vMasternodes[8].outpoint, info));
+    BOOST_CHECK_EQUAL(info.nActiveState, CMasternode::MASTERNODE_POSE_BAN);
+    BOOST_CHECK(mnman.GetMasternodeInfo(vMasternodes[8].pubKeyMasternode, info));
+    BOOST_CHECK_EQUAL(info.nActiveState, CMasternode::MASTERNODE_POSE_BAN);
+
+    mnman.Clear();
+    BOOST_CHECK(!mnman.Has(vMasternodes[0].outpoint));
+    BOOST_CHECK(!mnman.GetMasternodeInfo(vMasternodes[0].pubKeyMasternode, info));
+}
+
+BOOST_AUTO_TEST_CASE(masternodeman_key_index)
+{
+    CMasternodeMan mnman;
+    CMasternode mn1 = MakeMasternode(1);
+    CMasternode mn2 = MakeMasternode(2);
+    mn2.pubKeyMasternode = mn1.pubKeyMasternode;
+    mn2.pubKeyCollateralAddress = mn1.pubKeyCollateralAddress;
+    BOOST_CHECK(mnman.Add(mn1));
+    BOOST_CHECK(mnman.Add(mn2));
+
+    // entries sharing a key resolve to the lowest outpoint
+    COutPoint outpointLowest = std::min(mn1.outpoint, mn2.outpoint);
+    CScript payee = GetScriptForDestination(mn1.pubKeyCollateralAddress.GetID());
+    masternode_info_t info;
+    BOOST_CHECK(mnman.GetMasternodeInfo(mn1.pubKeyMasternode, info));
+    BOOST_CHECK(info.outpoint == outpointLowest);
+    BOOST_CHECK(mnman.GetMasternodeInfo(payee, info));
+    BOOST_CHECK(info.outpoint == outpointLowest);
+
+    // only the P2PKH script pays the collateral address
+    BOOST_CHECK(!mnman.GetMasternodeInfo(GetScriptForRawPubKey(mn1.pubKeyCollateralAddress), info));
+    BOOST_CHECK(!mnman.GetMasternodeInfo(CScript() << OP_TRUE, info));
+
+    // removing one entry leaves the other one
+    CMasternode mn3 = MakeMasternode(3);
+    BOOST_CHECK(mnman.Add(mn3));
+    BOOST_CHECK(mnman.Remove(mn3.outpoint));
+    BOOST_CHECK(!mnman.Remove(mn3.outpoint));
+    BOOST_CHECK(!mnman.Has(mn3.outpoint));
+    BOOST_CHECK(!mnman.GetMasternodeInfo(mn3.outpoint, info));
+    BOOST_CHECK(!mnman.GetMasternodeInfo(mn3.pubKeyMasternode, info));
+    BOOST_CHECK(!mnman.GetMasternodeInfo(GetScriptForDestination(mn3.pubKeyCollateralAddress.GetID()), info));
+    BOOST_CHECK(mnman.Remove(outpointLowest));
+    COutPoint outpointOther = outpointLowest == mn1.outpoint ? mn2.outpoint : mn1.outpoint;
+    BOOST_CHECK(!mnman.GetMasternodeInfo(outpointLowest, info));
+    BOOST_CHECK(mnman.GetMasternodeInfo(mn1.pubKeyMasternode, info));
+    BOOST_CHECK(info.outpoint == outpointOther);
+    BOOST_CHECK(mnman.GetMasternodeInfo(payee, info));
+    BOOST_CHECK(info.outpoint == outpointOther);
+    BOOST_CHECK_EQUAL(mnman.size(), 1);
+
+    // the index follows removals
+    CMasternodeMan mnmanSingle;
+    BOOST_CHECK(mnmanSingle.Add(mn2));
+    BOOST_CHECK(mnmanSingle.GetMasternodeInfo(payee, info));
+    BOOST_CHECK(info.outpoint == mn2.outpoint);
+    mnmanSingle.Clear();
+    BOOST_CHECK(!mnmanSingle.GetMasternodeInfo(payee, info));
+    BOOST_CHECK(!mnmanSingle.GetMasternodeInfo(mn2.pubKeyMasternode, info));
+}
+
+BOOST_FIXTURE_TEST_CASE(masternodeman_rank_cache, TestingSetup)
+{
+    // ranks are only served once the list is synced
+    masternodeSync.Reset();
+    while (!masternodeSync.IsMasternodeListSynced()) {
+        masternodeSync.SwitchToNextAsset(*connman);
+    }
+
+    CMasternodeMan mnman;
+    std::vector<CMasternode> vMasternodes;
+    for (int i = 0; i < 20; i++) {
+        vMasternodes.push_back(MakeMasternode(i));
+        vMasternodes.back().nProtocolVersion = PROTOCOL_VERSION - (i % 2);
+        BOOST_CHECK(mnman.Add(vMasternodes.back()));
+    }
+
+    uint256 nBlockHash = chainActive.Tip()->GetBlockHash();
+    std::vector<std::pair<arith_uint256, COutPoint> > vecScores;
+    for (const auto& mn : vMasternodes) {
+        vecScores.push_back(std::make_pair(mn.CalculateScore(nBlockHash), mn.outpoint));
+    }
+    std::sort(vecScores.rbegin(), vecScores.rend());
+
+    // twice, the second time from the cache
+    for (int nRound = 0; nRound < 2; nRound++) {
+        for (size_t i = 0; i < vecScores.size(); i++) {
+            int nRank;
+            BOOST_CHECK(mnman.GetMasternodeRank(vecScores[i].second, nRank, 0));
+            BOOST_CHECK_EQUAL(nRank, (int)i + 1);
+        }
+    }
+
+    CMasternodeMan::rank_pair_vec_t vecRanks;
+    BOOST_CHECK(mnman.GetMasternodeRanks(vecRanks, 0));
+    BOOST_CHECK_EQUAL(vecRanks.size(), vecScores.size());
+    for (size_t i = 0; i < vecRanks.size(); i++) {
+        BOOST_CHECK_EQUAL(vecRanks[i].first, (int)i + 1);
+        BOOST_CHECK(vecRanks[i].second.outpoint == vecScores[i].second);
+    }
+
+    // min protocol filters and is cached separately
+    BOOST_CHECK(mnman.GetMasternodeRanks(vecRanks, 0, PROTOCOL_VERSION));
+    BOOST_CHECK_EQUAL(vecRanks.size(), vecScores.size() / 2);
+    for (const auto& rankPair : vecRanks) {
+        BOOST_CHECK_EQUAL(rankPair.second.nProtocolVersion, PROTOCOL_VERSION);
+    }
+
+    // adding an entry invalidates the cached ranks
+    CMasternode mnNew = MakeMasternode(100);
+    BOOST_CHECK(mnman.Add(mnNew));
+    int nRank;
+    BOOST_CHECK(mnman.GetMasternodeRank(mnNew.outpoint, nRank, 0));
+    BOOST_CHECK(mnman.GetMasternodeRanks(vecRanks, 0));
+    BOOST_CHECK_EQUAL(vecRanks.size(), vecScores.size() + 1);
+    BOOST_CHECK(vecRanks[nRank - 1].second.outpoint == mnNew.outpoint);
+
+    masternodeSync.Reset();
+}
+
+static CMasternodePing MakePing(const COutPoint& outpoint, const CKey& keyMasternode)
+{
+    // the test chain is too short for CMasternodePing(outpoint)
+    CMasternodePing mnp;
+    mnp.masternodeOutpoint = outpoint;
+    mnp.blockHash = chainActive.Tip()->GetBlockHash();
+    mnp.nDaemonVersion = CLIENT_VERSION;
+    BOOST_CHECK(mnp.Sign(keyMasternode, keyMasternode.GetPubKey()));
+    return mnp;
+}
+
+BOOST_FIXTURE_TEST_CASE(masternodeman_ping_queue, TestingSetup)
+{
+    CKey keyCollateral;
+    CKey keyMasternode;
+    keyCollateral.MakeNewKey(true);
+    keyMasternode.MakeNewKey(true);
+    CMasternode mn(CService(CNetAddr(), 7000), COutPoint(GetRandHash(), 0), keyCollateral.GetPubKey(), keyMasternode.GetPubKey(), PROTOCOL_VERSION);
+    CMasternodeMan mnman;
+    BOOST_CHECK(mnman.Add(mn));
+
+    int64_t nTimeStart = GetTime();
+    std::vector<CMasternodePing> vecPings;
+    for (int64_t nOffset : {0, 100, 50}) {
+        SetMockTime(nTimeStart + nOffset);
+        vecPings.push_back(MakePing(mn.outpoint, keyMasternode));
+    }
+
+    // a newer ping replaces the queued one, an older one is dropped
+    for (const auto& mnp : vecPings) {
+        BOOST_CHECK(!mnman.AddPendingPing(mnp, 0));
+    }
+    CMasternodePingQueueStats stats = mnman.GetPingQueueStats();
+    BOOST_CHECK_EQUAL(stats.nQueued, 1U);
+    BOOST_CHECK_EQUAL(stats.nSuperseded, 2U);
+
+    mnman.ProcessPendingPings(*connman);
+    stats = mnman.GetPingQueueStats();
+    BOOST_CHECK_EQUAL(stats.nQueued, 0U);
+    BOOST_CHECK_EQUAL(stats.nProcessed, 1U);
+    BOOST_CHECK_EQUAL(stats.nBatches, 1U);
+    masternode_info_t info;
+    BOOST_CHECK(mnman.GetMasternodeInfo(mn.outpoint, info));
+    BOOST_CHECK_EQUAL(info.nTimeLastPing, nTimeStart + 100);
+
+    // a newer ping with a bad signature doesn't replace a valid one, whichever comes first
+    CKey keyForged;
+    keyForged.MakeNewKey(true);
+    for (int i = 0; i < 2; i++) {
+        int64_t nTimePing = nTimeStart + 100 + (i + 1) * MASTERNODE_MIN_MNP_SECONDS;
+        SetMockTime(nTimePing);
+        CMasternodePing mnpValid = MakePing(mn.outpoint, keyMasternode);
+        SetMockTime(nTimePing + 1);
+        CMasternodePing mnpForged = MakePing(mn.outpoint, keyForged);
+        BOOST_CHECK(!mnman.AddPendingPing(i == 0 ? mnpValid : mnpForged, 0));
+        BOOST_CHECK(!mnman.AddPendingPing(i == 0 ? mnpForged : mnpValid, 0));
+        BOOST_CHECK_EQUAL(mnman.GetPingQueueStats().nQueued, 1U);
+        mnman.ProcessPendingPings(*connman);
+        BOOST_CHECK(mnman.GetMasternodeInfo(mn.outpoint, info));
+        BOOST_CHECK_EQUAL(info.nTimeLastPing, nTimePing);
+    }
+
+    // without the message signature cache signatures are only checked once, when applying the ping
+    ForceSetArg("-maxmsgsigcachesize", "0");
+    InitMessageSignatureCache();
+    BOOST_CHECK_EQUAL(GetMessageSignatureCacheStats().nElements, 0U);
+    SetMockTime(nTimeStart + 100 + 3 * MASTERNODE_MIN_MNP_SECONDS);
+    BOOST_CHECK(!mnman.AddPendingPing(MakePing(mn.outpoint, keyMasternode), 0));
+    mnman.ProcessPendingPings(*connman);
+    BOOST_CHECK(mnman.GetMasternodeInfo(mn.outpoint, info));
+    BOOST_CHECK_EQUAL(info.nTimeLastPing, nTimeStart + 100 + 3 * MASTERNODE_MIN_MNP_SECONDS);
+
+    ForceSetArg("-maxmsgsigcachesize", std::to_string(DEFAULT_MAX_MSG_SIG_CACHE_SIZE));
+    InitMessageSignatureCache();
+    SetMockTime(0);
+}
+
+static void BuildHeaderChain(std::vector<CBlockIndex>& vBlocks, std::vector<uint256>& vHashes, CBlockIndex* pindexFork, int nLength)
+{
+    vBlocks.resize(nLength);
+    vHashes.resize(nLength);
+    for (int i = 0; i < nLength; i++) {
+        vHashes[i] = GetRandHash();
+        vBlocks[i].phashBlock = &vHashes[i];
+        vBlocks[i].pprev = i ? &vBlocks[i - 1] : pindexFork;
+        vBlocks[i].nHeight = pindexFork->nHeight + i + 1;
+        vBlocks[i].BuildSkip();
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(masternodeman_payment_queue, TestingSetup)
+{
+    // there is no payment queue without the winners list
+    masternodeSync.Reset();
+    while (!masternodeSync.IsWinnersListSynced()) {
+        masternodeSync.SwitchToNextAsset(*connman);
+    }
+
+    // headers only, enough for the collateral confirmations and the block the scores are taken from,
+    // and a longer branch forking off at height 150
+    CBlockIndex* pindexGenesis = chainActive.Tip();
+    std::vector<CBlockIndex> vMain, vFork;
+    std::vector<uint256> vMainHashes, vForkHashes;
+    BuildHeaderChain(vMain, vMainHashes, pindexGenesis, 200);
+    BuildHeaderChain(vFork, vForkHashes, &vMain[149], 60);
+    {
+        LOCK(cs_main);
+        chainActive.SetTip(&vMain.back());
+    }
+    CMasternodeMan mnman;
+    mnman.UpdatedBlockTip(&vMain.back());
+
+    // paid in the reverse order of adding, the collateral of the one paid longest ago is unknown yet
+    CTxOut txout(1000 * COIN, CScript() << OP_TRUE);
+    std::vector<CMasternode> vMasternodes;
+    for (int i = 0; i < 10; i++) {
+        vMasternodes.push_back(MakeMasternode(i));
+        vMasternodes.back().nActiveState = CMasternode::MASTERNODE_ENABLED;
+        vMasternodes.back().nBlockLastPaid = 100 - i;
+        BOOST_CHECK(mnman.Add(vMasternodes.back()));
+        if (i < 9) {
+            LOCK(cs_main);
+            pcoinsTip->AddCoin(vMasternodes.back().outpoint, Coin(txout, 100, false), false);
+        }
+    }
+
+    // with ten entries only the oldest payment is scored
+    int nBlockHeight = vMain.back().nHeight + 1;
+    int nCount;
+    masternode_info_t info;
+    BOOST_CHECK(mnman.GetNextMasternodeInQueueForPayment(nBlockHeight, false, nCount, info));
+    BOOST_CHECK_EQUAL(nCount, 9);
+    BOOST_CHECK(info.outpoint == vMasternodes[8].outpoint);
+
+    // an unknown collateral height is looked up again on the next call
+    {
+        LOCK(cs_main);
+        pcoinsTip->AddCoin(vMasternodes[9].outpoint, Coin(txout, 100, false), false);
+    }
+    BOOST_CHECK(mnman.GetNextMasternodeInQueueForPayment(nBlockHeight, false, nCount, info));
+    BOOST_CHECK_EQUAL(nCount, 10);
+    BOOST_CHECK(info.outpoint == vMasternodes[9].outpoint);
+
+    // the queue follows removals
+    BOOST_CHECK(mnman.Remove(vMasternodes[9].outpoint));
+    BOOST_CHECK(mnman.GetNextMasternodeInQueueForPayment(nBlockHeight, false, nCount, info));
+    BOOST_CHECK_EQUAL(nCount, 9);
+    BOOST_CHECK(info.outpoint == vMasternodes[8].outpoint);
+
+    // after a reorg moving its collateral to the tip of the new branch the next in line is too new,
+    // the height cached on the old branch must not be used
+    {
+        LOCK(cs_main);
+        pcoinsTip->SpendCoin(vMasternodes[8].outpoint);
+        pcoinsTip->AddCoin(vMasternodes[8].outpoint, Coin(txout, vFork.back().nHeight, false), false);
+        chainActive.SetTip(&vFork.back());
+    }
+    mnman.UpdatedBlockTip(&vFork.back());
+    nBlockHeight = vFork.back().nHeight + 1;
+    BOOST_CHECK(mnman.GetNextMasternodeInQueueForPayment(nBlockHeight, false, nCount, info));
+    BOOST_CHECK_EQUAL(nCount, 8);
+    BOOST_CHECK(info.outpoint == vMasternodes[7].outpoint);
+
+    {
+        LOCK(cs_main);
+        chainActive.SetTip(pindexGenesis);
+    }
+    masternodeSync.Reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,54 @@
+// Copyright (c) 2019 The Kepler developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "messagesigner.h"
+
+#include "test/test_kepler.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(messagesigner_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(messagesigner_sigcache)
+{
+    CKey key;
+    CKey keyOther;
+    key.MakeNewKey(true);
+    keyOther.MakeNewKey(true);
+    uint256 hash = GetRandHash();
+    std::vector<unsigned char> vchSig;
+    std::string strError;
+    BOOST_CHECK(CHashSigner::SignHash(hash, key, vchSig));
+
+    // the second check of the same signature is a cache hit
+    CMessageSignatureCacheStats statsBefore = GetMessageSignatureCacheStats();
+    BOOST_CHECK(statsBefore.nElements > 0);
+    BOOST_CHECK(CHashSigner::VerifyHash(hash, key.GetPubKey(), vchSig, strError));
+    BOOST_CHECK(CHashSigner::VerifyHash(hash, key.GetPubKey(), vchSig, strError));
+    CMessageSignatureCacheStats statsAfter = GetMessageSignatureCacheStats();
+    BOOST_CHECK_EQUAL(statsAfter.nLookups - statsBefore.nLookups, 2U);
+    BOOST_CHECK_EQUAL(statsAfter.nHits - statsBefore.nHits, 1U);
+
+    // a cached signature is still checked against the key and the hash
+    BOOST_CHECK(!CHashSigner::VerifyHash(hash, keyOther.GetPubKey(), vchSig, strError));
+    BOOST_CHECK(!CHashSigner::VerifyHash(GetRandHash(), key.GetPubKey(), vchSig, strError));
+
+    // invalid signatures are never cached
+    statsBefore = GetMessageSignatureCacheStats();
+    BOOST_CHECK(!CHashSigner::VerifyHash(hash, keyOther.GetPubKey(), vchSig, strError));
+    statsAfter = GetMessageSignatureCacheStats();
+    BOOST_CHECK_EQUAL(statsAfter.nHits, statsBefore.nHits);
+
+    // messages go through the same cache
+    std::string strMessage = "message";
+    BOOST_CHECK(CMessageSigner::SignMessage(strMessage, vchSig, key));
+    statsBefore = GetMessageSignatureCacheStats();
+    BOOST_CHECK(CMessageSigner::VerifyMessage(key.GetPubKey(), vchSig, strMessage, strError));
+    BOOST_CHECK(CMessageSigner::VerifyMessage(key.GetPubKey().GetID(), vchSig, strMessage, strError));
+    BOOST_CHECK(!CMessageSigner::VerifyMessage(key.GetPubKey(), vchSig, "other message", strError));
+    statsAfter = GetMessageSignatureCacheStats();
+    BOOST_CHECK_EQUAL(statsAfter.nHits - statsBefore.nHits, 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -44,6 +44,32 @@ BOOST_AUTO_TEST_CASE(skiplist_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(prevalgo_test)
+{
+    std::vector<CBlockIndex> vIndex(SKIPLIST_LENGTH);
+
+    for (int i=0; i<SKIPLIST_LENGTH; i++) {
+        CBlockHeader header;
+        // Long runs of a single algo so some algos go idle for a while
+        header.SetAlgo((i / 100) % 7 == 0 ? insecure_rand() % NUM_ALGOS : ALGO_SLOT1);
+        vIndex[i].nVersion = header.nVersion;
+        vIndex[i].nHeight = i;
+        vIndex[i].pprev = (i == 0) ? NULL : &vIndex[i - 1];
+        vIndex[i].BuildPrevAlgo();
+    }
+
+    for (int i=0; i < 1000; i++) {
+        int from = insecure_rand() % SKIPLIST_LENGTH;
+        for (int algo = 0; algo < NUM_ALGOS; algo++) {
+            const CBlockIndex* pindexWalk = &vIndex[from];
+            while (pindexWalk && pindexWalk->GetAlgo() != algo)
+                pindexWalk = pindexWalk->pprev;
+            BOOST_CHECK(GetLastBlockIndexForAlgo(&vIndex[from], algo) == pindexWalk);
+            BOOST_CHECK(vIndex[from].pprevAlgo[algo] == GetLastBlockIndexForAlgo(vIndex[from].pprev, algo));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(getlocator_test)
 {
     // Build a main chain 100000 blocks long.
@@ -6,8 +6,10 @@
 #include "txdb.h"
 
 #include "chainparams.h"
+#include "checkqueue.h"
 #include "hash.h"
 #include "pow.h"
+#include "random.h"
 #include "uint256.h"
 #include "ui_interface.h"
 #include "init.h"
@@ -31,6 +33,22 @@ static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 
+PoWLoadCheck nPoWLoadCheck = POW_LOAD_CHECK_SAMPLED;
+
+bool ParsePoWLoadCheck(const std::string& strMode, PoWLoadCheck& mode)
+{
+    if (strMode == "0") {
+        mode = POW_LOAD_CHECK_NONE;
+    } else if (strMode == "1") {
+        mode = POW_LOAD_CHECK_ALL;
+    } else if (strMode == "sampled") {
+        mode = POW_LOAD_CHECK_SAMPLED;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 namespace {
 
 struct CoinEntry {
@@ -344,12 +362,17 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex, CCheckQueue<CPoWCheck>* pqueue)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    FastRandomContext insecure_rand;
+    // Entries whose PoW hash is missing or has to be verified
+    std::vector<CBlockIndex*> vRecompute;
+
     // Load mapBlockIndex
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
@@ -371,9 +394,14 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
                 pindexNew->nNonce         = diskindex.nNonce;
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
+                pindexNew->hashPoW        = diskindex.hashPoW;
 
-                if (!CheckProofOfWork(pindexNew->GetBlockPoWHash(), pindexNew->GetAlgo(), pindexNew->nBits, Params().GetConsensus()))
+                if (pindexNew->hashPoW.IsNull() || nPoWLoadCheck == POW_LOAD_CHECK_ALL ||
+                        (nPoWLoadCheck == POW_LOAD_CHECK_SAMPLED && insecure_rand.rand32(POW_LOAD_CHECK_SAMPLE_RATE) == 0)) {
+                    vRecompute.push_back(pindexNew);
+                } else if (!CheckProofOfWork(pindexNew->hashPoW, pindexNew->GetAlgo(), pindexNew->nBits, consensusParams)) {
                     return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
+                }
 
                 pcursor->Next();
             } else {
@@ -384,6 +412,69 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
         }
     }
 
+    LogPrintf("%s: recomputing %u PoW hashes\n", __func__, vRecompute.size());
+
+    // Entries written before the PoW hash was stored, to be rewritten once loaded
+    std::vector<const CBlockIndex*> vUpgrade;
+    std::vector<uint256> vHashPoW;
+    std::vector<CPoWCheck> vChecks;
+    for (size_t nStart = 0; nStart < vRecompute.size(); nStart += POW_LOAD_CHECK_BATCH_SIZE) {
+        boost::this_thread::interruption_point();
+        size_t nEnd = std::min(vRecompute.size(), nStart + POW_LOAD_CHECK_BATCH_SIZE);
+        vHashPoW.assign(nEnd - nStart, uint256());
+        vChecks.clear();
+        for (size_t i = nStart; i < nEnd; i++)
+            vChecks.push_back(CPoWCheck(vRecompute[i]->GetBlockHeader(), &vHashPoW[i - nStart], consensusParams));
+
+        bool fPoWOk = true;
+        if (pqueue != NULL) {
+            CCheckQueueControl<CPoWCheck> control(pqueue);
+            control.Add(vChecks);
+            fPoWOk = control.Wait();
+        } else {
+            for (CPoWCheck& check : vChecks) {
+                if (!(fPoWOk = check()))
+                    break;
+            }
+        }
+
+        for (size_t i = nStart; i < nEnd; i++) {
+            CBlockIndex* pindex = vRecompute[i];
+            const uint256& hashPoW = vHashPoW[i - nStart];
+            // The queue stops computing hashes once a check has failed
+            if (hashPoW.IsNull())
+                continue;
+            if (pindex->hashPoW.IsNull()) {
+                pindex->hashPoW = hashPoW;
+                pindex->nStatus |= BLOCK_HAVE_POWHASH;
+                vUpgrade.push_back(pindex);
+            } else if (pindex->hashPoW != hashPoW) {
+                return error("%s: stored PoW hash mismatch: %s", __func__, pindex->ToString());
+            }
+            if (!CheckProofOfWork(hashPoW, pindex->GetAlgo(), pindex->nBits, consensusParams))
+                return error("%s: CheckProofOfWork failed: %s", __func__, pindex->ToString());
+        }
+        if (!fPoWOk)
+            return error("%s: CheckProofOfWork failed", __func__);
+    }
+
+    if (!vUpgrade.empty()) {
+        // Store the PoW hashes computed above so the next startup doesn't have to
+        LogPrintf("Upgrading %u block index entries with PoW hashes...\n", vUpgrade.size());
+        size_t batch_size = 1 << 24;
+        CDBBatch batch(*this);
+        for (const CBlockIndex* pindex : vUpgrade) {
+            batch.Write(std::make_pair(DB_BLOCK_INDEX, pindex->GetBlockHash()), CDiskBlockIndex(pindex));
+            if (batch.SizeEstimate() > batch_size) {
+                if (!WriteBatch(batch))
+                    return error("%s: failed to write upgraded block index entries", __func__);
+                batch.Clear();
+            }
+        }
+        if (!WriteBatch(batch, true))
+            return error("%s: failed to write upgraded block index entries", __func__);
+    }
+
     return true;
 }
 
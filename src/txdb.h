@@ -20,8 +20,12 @@
 
 class CBlockIndex;
 class CCoinsViewDBCursor;
+class CPoWCheck;
 class uint256;
 
+template <typename T>
+class CCheckQueue;
+
 //! Compensate for extra memory peak (x1.5-x1.9) at flush time.
 static constexpr int DB_PEAK_USAGE_FACTOR = 2;
 //! No need to periodic flush if at least this much space still available.
@@ -41,6 +45,24 @@ static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
+/** How block index entries have their proof of work checked at startup (-checkpowonload) */
+enum PoWLoadCheck {
+    POW_LOAD_CHECK_NONE,    //!< only check stored PoW hashes against nBits
+    POW_LOAD_CHECK_ALL,     //!< recompute the PoW hash of every entry
+    POW_LOAD_CHECK_SAMPLED, //!< recompute the PoW hash of a random sample of entries
+};
+//! -checkpowonload default
+static const char* const DEFAULT_CHECKPOWONLOAD = "sampled";
+//! In sampled mode, recompute the PoW hash of one in this many block index entries
+static const unsigned int POW_LOAD_CHECK_SAMPLE_RATE = 1000;
+//! Number of block index entries whose PoW hashes are recomputed per check queue batch
+static const size_t POW_LOAD_CHECK_BATCH_SIZE = 10000;
+
+extern PoWLoadCheck nPoWLoadCheck;
+
+/** Parse a -checkpowonload value ("0", "1" or "sampled") */
+bool ParsePoWLoadCheck(const std::string& strMode, PoWLoadCheck& mode);
+
 struct CDiskTxPos : public CDiskBlockPos
 {
     unsigned int nTxOffset; // after header
@@ -138,7 +160,7 @@ public:
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &vect);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex, CCheckQueue<CPoWCheck>* pqueue);
 };
 
 #endif // BITCOIN_TXDB_H
@@ -70,6 +70,7 @@ CBlockIndex *pindexBestHeader = NULL;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
+int nPoWCheckThreads = 0;
 std::atomic_bool fImporting(false);
 bool fReindex = false;
 bool fTxIndex = true;
@@ -1207,13 +1208,21 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
 bool CheckProofOfWork(const CBlockHeader& block, const Consensus::Params& params)
 {
     int algo = block.GetAlgo();
-    if (!CheckProofOfWork(block.GetPoWHash(algo), algo, block.nBits, params))
+    uint256 hash = block.GetHash();
+    uint256 hashPoW;
+    // Blocks relayed by several peers or read back from disk were usually checked moments ago
+    bool fCached = GetCachedPoWHash(hash, hashPoW);
+    if (!fCached)
+        hashPoW = block.GetPoWHash(algo);
+    if (!CheckProofOfWork(hashPoW, algo, block.nBits, params))
         return error("%s (val.cpp) : proof of work failed, hash=%s, algo=%d, nVersion=%d, PoWHash=%s",
         __func__,
-        block.GetHash().ToString(),
+        hash.ToString(),
         algo,
         block.nVersion,
-        block.GetPoWHash(algo).ToString());
+        hashPoW.ToString());
+    if (!fCached)
+        CachePoWHash(hash, hashPoW);
     return true;
 }   
 
@@ -1238,7 +1247,8 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+/** Read a block without checking its header */
+static bool ReadBlockFromDiskUnchecked(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
@@ -1255,6 +1265,14 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
 
+    return true;
+}
+
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+{
+    if (!ReadBlockFromDiskUnchecked(block, pos))
+        return false;
+
     // Check the header
     if (!CheckProofOfWork(block, consensusParams))
         return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
@@ -1264,8 +1282,15 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
 
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
-    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams))
+    // With the PoW hash stored in the index entry the header only has to match the entry
+    if (pindex->nStatus & BLOCK_HAVE_POWHASH) {
+        if (!ReadBlockFromDiskUnchecked(block, pindex->GetBlockPos()))
+            return false;
+        if (!CheckProofOfWork(pindex->hashPoW, pindex->GetAlgo(), pindex->nBits, consensusParams))
+            return error("ReadBlockFromDisk: Errors in block header at %s", pindex->GetBlockPos().ToString());
+    } else if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams)) {
         return false;
+    }
     if (block.GetHash() != pindex->GetBlockHash()) // !!!
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
                 pindex->ToString(), pindex->GetBlockPos().ToString());
@@ -1935,6 +1960,13 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CPoWCheck> powcheckqueue(8);
+
+void ThreadPoWCheck() {
+    RenameThread("kepler-powcheck");
+    powcheckqueue.Thread();
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2026,8 +2058,10 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
     int64_t nTimeStart = GetTimeMicros();
 
-    // Check it again in case a previous version let a bad block in
-    if (!CheckBlock(block, state, chainparams.GetConsensus(), !fJustCheck, !fJustCheck))
+    // Check it again in case a previous version let a bad block in. The PoW hash stored
+    // with the index entry was checked when the header was accepted.
+    bool fCheckPOW = !fJustCheck && !(pindex->nStatus & BLOCK_HAVE_POWHASH);
+    if (!CheckBlock(block, state, chainparams.GetConsensus(), fCheckPOW, !fJustCheck))
         return error("%s: Consensus::CheckBlock: %s", __func__, FormatStateMessage(state));
 
     // verify that the view's current state corresponds to the previous block
@@ -3135,6 +3169,7 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
         pindexNew->pprev = (*miPrev).second;
         pindexNew->nHeight = pindexNew->pprev->nHeight + 1;
         pindexNew->BuildSkip();
+        pindexNew->BuildPrevAlgo();
     }
     pindexNew->nTimeMax = (pindexNew->pprev ? std::max(pindexNew->pprev->nTimeMax, pindexNew->nTime) : pindexNew->nTime);
     pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
@@ -3481,7 +3516,7 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, const Co
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, const uint256* phashPoW = NULL)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
@@ -3502,7 +3537,14 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        // The PoW hash may have been computed on the PoW check threads already
+        if (phashPoW) {
+            if (!CheckProofOfWork(*phashPoW, block.GetAlgo(), block.nBits, chainparams.GetConsensus()))
+                return state.DoS(50, error("%s: proof of work failed, hash=%s", __func__, hash.ToString()), REJECT_INVALID, "high-hash");
+            CachePoWHash(hash, *phashPoW);
+        }
+
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), phashPoW == NULL))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -3536,8 +3578,14 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
         if (!ContextualCheckBlockHeader(block, state, chainparams.GetConsensus(), pindexPrev, GetAdjustedTime()))
             return error("%s: Consensus::ContextualCheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
     }
-    if (pindex == NULL)
+    if (pindex == NULL) {
         pindex = AddToBlockIndex(block);
+        if (phashPoW)
+            pindex->hashPoW = *phashPoW;
+        else if (!GetCachedPoWHash(hash, pindex->hashPoW))
+            pindex->hashPoW = block.GetPoWHash(block.GetAlgo()); // evicted already, or the PoW check was skipped
+        pindex->nStatus |= BLOCK_HAVE_POWHASH;
+    }
 
     if (ppindex)
         *ppindex = pindex;
@@ -3553,11 +3601,30 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex)
 {
+    // Compute the PoW hashes of unknown headers on the PoW check threads before
+    // taking cs_main for the sequential checks. Hashes of failed checks are
+    // rechecked (and rejected) in order by AcceptBlockHeader.
+    std::vector<uint256> vHashPoW(headers.size());
+    if (nPoWCheckThreads && headers.size() > 1) {
+        std::vector<CPoWCheck> vChecks;
+        {
+            LOCK(cs_main);
+            for (size_t i = 0; i < headers.size(); i++) {
+                if (!mapBlockIndex.count(headers[i].GetHash()))
+                    vChecks.push_back(CPoWCheck(headers[i], &vHashPoW[i], chainparams.GetConsensus()));
+            }
+        }
+        CCheckQueueControl<CPoWCheck> control(&powcheckqueue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); i++) {
+            const CBlockHeader& header = headers[i];
             CBlockIndex *pindex = NULL; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!AcceptBlockHeader(header, state, chainparams, &pindex, vHashPoW[i].IsNull() ? NULL : &vHashPoW[i])) {
                 return false;
             }
             if (ppindex) {
@@ -3911,7 +3978,7 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
 
 bool static LoadBlockIndexDB(const CChainParams& chainparams)
 {
-    if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex))
+    if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex, nPoWCheckThreads ? &powcheckqueue : NULL))
         return false;
 
     boost::this_thread::interruption_point();
@@ -3948,8 +4015,10 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
             setBlockIndexCandidates.insert(pindex);
         if (pindex->nStatus & BLOCK_FAILED_MASK && (!pindexBestInvalid || pindex->nChainWork > pindexBestInvalid->nChainWork))
             pindexBestInvalid = pindex;
-        if (pindex->pprev)
+        if (pindex->pprev) {
             pindex->BuildSkip();
+            pindex->BuildPrevAlgo();
+        }
         if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == NULL || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
             pindexBestHeader = pindex;
     }
@@ -4183,6 +4252,9 @@ static bool AddGenesisBlock(const CChainParams& chainparams, const CBlock& block
     if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart()))
         return error("%s: writing genesis block to disk failed", __func__);
     CBlockIndex *pindex = AddToBlockIndex(block);
+    if (!GetCachedPoWHash(pindex->GetBlockHash(), pindex->hashPoW))
+        pindex->hashPoW = block.GetPoWHash(block.GetAlgo());
+    pindex->nStatus |= BLOCK_HAVE_POWHASH;
     if (!ReceivedBlockTransactions(block, state, pindex, blockPos))
         return error("%s: genesis block not accepted", __func__);
     return true;
@@ -4432,6 +4504,7 @@ void static CheckBlockIndex(const Consensus::Params& consensusParams)
         assert(pindex->nHeight == nHeight); // nHeight must be consistent.
         assert(pindex->pprev == NULL || pindex->nChainWork >= pindex->pprev->nChainWork); // For every block except the genesis block, the chainwork must be larger than the parent's.
         assert(nHeight < 2 || (pindex->pskip && (pindex->pskip->nHeight < nHeight))); // The pskip pointer must point back for all but the first 2 blocks.
+        assert(pindex->pprev == NULL || pindex->pprevAlgo[pindex->pprev->GetAlgo()] == pindex->pprev); // The parent must be the nearest predecessor of its own algo.
         assert(pindexFirstNotTreeValid == NULL); // All mapBlockIndex entries must at least be TREE valid
         if ((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TREE) assert(pindexFirstNotTreeValid == NULL); // TREE valid implies all parents are TREE valid
         if ((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_CHAIN) assert(pindexFirstNotChainValid == NULL); // CHAIN valid implies all parents are CHAIN valid
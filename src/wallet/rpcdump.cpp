@@ -146,6 +146,10 @@ UniValue importprivkey(const JSONRPCRequest& request)
         // whenever a key is imported, we need to scan the whole chain
         pwalletMain->UpdateTimeFirstKey(1);
 
+        // outputs to the key and inputs spending them are ours now
+        pwalletMain->ClearPrivateSendRounds();
+        pwalletMain->RebuildWalletUTXO();
+
         if (fRescan) {
             pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
         }
@@ -245,6 +249,9 @@ UniValue importaddress(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Kepler address or script");
     }
 
+    pwalletMain->ClearPrivateSendRounds();
+    pwalletMain->RebuildWalletUTXO();
+
     if (fRescan)
     {
         pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
@@ -397,6 +404,9 @@ UniValue importpubkey(const JSONRPCRequest& request)
     ImportAddress(CBitcoinAddress(pubKey.GetID()), strLabel);
     ImportScript(GetScriptForRawPubKey(pubKey), strLabel, false);
 
+    pwalletMain->ClearPrivateSendRounds();
+    pwalletMain->RebuildWalletUTXO();
+
     if (fRescan)
     {
         pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
@@ -498,6 +508,8 @@ UniValue importwallet(const JSONRPCRequest& request)
     pwalletMain->ShowProgress("", 100); // hide progress dialog in GUI
 
     pwalletMain->UpdateTimeFirstKey(nTimeBegin);
+    pwalletMain->ClearPrivateSendRounds();
+    pwalletMain->RebuildWalletUTXO();
 
     CBlockIndex *pindex = chainActive.FindEarliestAtLeast(nTimeBegin - 7200);
 
@@ -634,6 +646,8 @@ UniValue importelectrumwallet(const JSONRPCRequest& request)
     // Assume that electrum wallet was created at that block
     int nTimeBegin = chainActive[nStartHeight]->GetBlockTime();
     pwalletMain->UpdateTimeFirstKey(nTimeBegin);
+    pwalletMain->ClearPrivateSendRounds();
+    pwalletMain->RebuildWalletUTXO();
 
     LogPrintf("Rescanning %i blocks\n", chainActive.Height() - nStartHeight + 1);
     pwalletMain->ScanForWalletTransactions(chainActive[nStartHeight], true);
@@ -1270,6 +1284,9 @@ UniValue importmulti(const JSONRPCRequest& mainRequest)
         }
     }
 
+    pwalletMain->ClearPrivateSendRounds();
+    pwalletMain->RebuildWalletUTXO();
+
     if (fRescan && fRunScan && requests.size()) {
         CBlockIndex* pindex = nLowestTimestamp > minimumTimestamp ? chainActive.FindEarliestAtLeast(std::max<int64_t>(nLowestTimestamp - 7200, 0)) : chainActive.Genesis();
         CBlockIndex* scannedRange = nullptr;
@@ -9,6 +9,7 @@
 #include <utility>
 #include <vector>
 
+#include "privatesend.h"
 #include "rpc/server.h"
 #include "test/test_kepler.h"
 #include "validation.h"
@@ -361,6 +362,188 @@ BOOST_AUTO_TEST_CASE(ApproximateBestSubset)
     empty_wallet();
 }
 
+BOOST_AUTO_TEST_CASE(privatesend_rounds_persist)
+{
+    CPrivateSend::InitStandardDenominations();
+    const CAmount nDenom = CPrivateSend::GetStandardDenominations()[0];
+
+    CKey key;
+    key.MakeNewKey(true);
+    CScript scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+
+    // three mixing txs in a row, A spends an input which isn't ours
+    CMutableTransaction txA, txB, txC;
+    txA.vin.resize(1);
+    txA.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    txA.vout.assign(2, CTxOut(nDenom, scriptPubKey));
+    txB.vin.assign(1, CTxIn(COutPoint(txA.GetHash(), 0)));
+    txB.vout.assign(2, CTxOut(nDenom, scriptPubKey));
+    txC.vin.assign(1, CTxIn(COutPoint(txB.GetHash(), 0)));
+    txC.vout.assign(2, CTxOut(nDenom, scriptPubKey));
+    const COutPoint outpointA(txA.GetHash(), 0);
+    const COutPoint outpointC(txC.GetHash(), 0);
+
+    const std::string strWalletFile = "wallet_rounds_test.dat";
+    bool fFirstRun;
+    int nRounds;
+
+    LOCK(cs_main);
+    {
+        // C is seen before its inputs, it has no rounds yet
+        CWallet walletRounds(strWalletFile);
+        walletRounds.LoadWallet(fFirstRun);
+        LOCK(walletRounds.cs_wallet);
+        walletRounds.AddKeyPubKey(key, key.GetPubKey());
+        BOOST_CHECK(walletRounds.AddToWallet(CWalletTx(&walletRounds, MakeTransactionRef(txC))));
+        BOOST_CHECK(CWalletDB(strWalletFile).ReadPrivateSendRounds(outpointC, nRounds));
+        BOOST_CHECK_EQUAL(nRounds, 0);
+        // B is only written to disk, the rounds of C can only be stale after a reload if they come from disk
+        BOOST_CHECK(CWalletDB(strWalletFile).WriteTx(CWalletTx(&walletRounds, MakeTransactionRef(txB))));
+    }
+    {
+        CWallet walletRounds(strWalletFile);
+        walletRounds.LoadWallet(fFirstRun);
+        LOCK(walletRounds.cs_wallet);
+        BOOST_CHECK_EQUAL(walletRounds.GetRealOutpointPrivateSendRounds(outpointC, 0), 0);
+        // A new ancestor drops the rounds of its descendants, in memory and on disk
+        BOOST_CHECK(walletRounds.AddToWallet(CWalletTx(&walletRounds, MakeTransactionRef(txA))));
+        BOOST_CHECK(!CWalletDB(strWalletFile).ReadPrivateSendRounds(outpointC, nRounds));
+        BOOST_CHECK(CWalletDB(strWalletFile).ReadPrivateSendRounds(outpointA, nRounds));
+        BOOST_CHECK_EQUAL(nRounds, 0);
+        BOOST_CHECK_EQUAL(walletRounds.GetRealOutpointPrivateSendRounds(outpointC, 0), 2);
+    }
+}
+
+// The coins AvailableCoins used to find by going through all of mapWallet
+static std::vector<COutPoint> ScanAvailableCoins(const CWallet& wallet, AvailableCoinsType nCoinType)
+{
+    std::vector<COutPoint> vOutpoints;
+    for (const auto& pair : wallet.mapWallet) {
+        const CWalletTx& wtx = pair.second;
+        if (!CheckFinalTx(wtx) || (wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0))
+            continue;
+        if (wtx.GetDepthInMainChain(false) == 0 && !wtx.InMempool())
+            continue;
+        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+            const CAmount nValue = wtx.tx->vout[i].nValue;
+            bool found = true;
+            if (nCoinType == ONLY_DENOMINATED) {
+                found = CPrivateSend::IsDenominatedAmount(nValue);
+            } else if (nCoinType == ONLY_NONDENOMINATED) {
+                found = !CPrivateSend::IsCollateralAmount(nValue) && !CPrivateSend::IsDenominatedAmount(nValue);
+            } else if (nCoinType == ONLY_1000) {
+                found = nValue == Params().GetConsensus().nMasternodeCost * COIN;
+            } else if (nCoinType == ONLY_PRIVATESEND_COLLATERAL) {
+                found = CPrivateSend::IsCollateralAmount(nValue);
+            }
+            if (found && !wallet.IsSpent(pair.first, i) && wallet.IsMine(wtx.tx->vout[i]) != ISMINE_NO &&
+                    (!wallet.IsLockedCoin(pair.first, i) || nCoinType == ONLY_1000) && nValue > 0) {
+                vOutpoints.push_back(COutPoint(pair.first, i));
+            }
+        }
+    }
+    return vOutpoints;
+}
+
+static void CheckAvailableCoins(const CWallet& wallet)
+{
+    for (AvailableCoinsType nCoinType : {ALL_COINS, ONLY_DENOMINATED, ONLY_NONDENOMINATED, ONLY_1000, ONLY_PRIVATESEND_COLLATERAL}) {
+        std::vector<COutput> vCoins;
+        wallet.AvailableCoins(vCoins, false, NULL, false, nCoinType);
+        std::vector<COutPoint> vOutpoints;
+        for (const auto& out : vCoins) {
+            vOutpoints.push_back(COutPoint(out.tx->GetHash(), out.i));
+        }
+        BOOST_CHECK(vOutpoints == ScanAvailableCoins(wallet, nCoinType));
+    }
+}
+
+static uint256 AddTx(CWallet& wallet, const std::vector<COutPoint>& vInputs, const std::vector<CTxOut>& vOutputs, bool fConfirmed)
+{
+    CMutableTransaction tx;
+    for (const auto& outpoint : vInputs) {
+        tx.vin.push_back(CTxIn(outpoint));
+    }
+    tx.vout = vOutputs;
+    CWalletTx wtx(&wallet, MakeTransactionRef(tx));
+    if (fConfirmed) {
+        wtx.hashBlock = chainActive.Tip()->GetBlockHash();
+        wtx.nIndex = 0;
+    }
+    BOOST_CHECK(wallet.AddToWallet(wtx));
+    return tx.GetHash();
+}
+
+BOOST_AUTO_TEST_CASE(wallet_utxo_index)
+{
+    CPrivateSend::InitStandardDenominations();
+    const CAmount nDenom = CPrivateSend::GetStandardDenominations()[0];
+    const CAmount nMasternodeCost = Params().GetConsensus().nMasternodeCost * COIN;
+
+    CKey key, keyOther;
+    key.MakeNewKey(true);
+    keyOther.MakeNewKey(true);
+    CScript scriptMine = GetScriptForDestination(key.GetPubKey().GetID());
+    CScript scriptOther = GetScriptForDestination(keyOther.GetPubKey().GetID());
+
+    LOCK(cs_main);
+    CWallet walletUTXO("wallet_utxo_test.dat");
+    bool fFirstRun;
+    walletUTXO.LoadWallet(fFirstRun);
+    LOCK(walletUTXO.cs_wallet);
+    walletUTXO.AddKeyPubKey(key, key.GetPubKey());
+
+    // every kind of coin, and an output which isn't ours
+    const uint256 hashFund = AddTx(walletUTXO, {COutPoint(GetRandHash(), 0)}, {
+        CTxOut(nDenom, scriptMine),
+        CTxOut(5 * COIN, scriptMine),
+        CTxOut(CPrivateSend::GetMaxCollateralAmount(), scriptMine),
+        CTxOut(nMasternodeCost, scriptMine),
+        CTxOut(7 * COIN, scriptMine),
+        CTxOut(3 * COIN, scriptOther)}, true);
+    const COutPoint outDenom(hashFund, 0), outNonDenom(hashFund, 1), outCollateral(hashFund, 2), outMasternode(hashFund, 3), outNonDenom2(hashFund, 4);
+
+    BOOST_CHECK(walletUTXO.GetWalletUTXO(ALL_COINS) == std::set<COutPoint>({outDenom, outNonDenom, outCollateral, outMasternode, outNonDenom2}));
+    BOOST_CHECK(walletUTXO.GetWalletUTXO(ONLY_DENOMINATED) == std::set<COutPoint>({outDenom}));
+    BOOST_CHECK(walletUTXO.GetWalletUTXO(ONLY_NONDENOMINATED) == std::set<COutPoint>({outNonDenom, outMasternode, outNonDenom2}));
+    BOOST_CHECK(walletUTXO.GetWalletUTXO(ONLY_PRIVATESEND_COLLATERAL) == std::set<COutPoint>({outCollateral}));
+    BOOST_CHECK(walletUTXO.GetWalletUTXO(ONLY_1000) == std::set<COutPoint>({outMasternode}));
+    CheckAvailableCoins(walletUTXO);
+
+    // spent outputs are removed from all kinds, new ones are added
+    const uint256 hashSpend = AddTx(walletUTXO, {outNonDenom}, {CTxOut(4 * COIN, scriptMine)}, true);
+    BOOST_CHECK(!walletUTXO.GetWalletUTXO(ALL_COINS).count(outNonDenom));
+    BOOST_CHECK(!walletUTXO.GetWalletUTXO(ONLY_NONDENOMINATED).count(outNonDenom));
+    BOOST_CHECK(walletUTXO.GetWalletUTXO(ONLY_NONDENOMINATED).count(COutPoint(hashSpend, 0)));
+    CheckAvailableCoins(walletUTXO);
+
+    // abandoning a spend puts its inputs back
+    const uint256 hashAbandon = AddTx(walletUTXO, {outDenom}, {CTxOut(nDenom, scriptOther)}, false);
+    BOOST_CHECK(!walletUTXO.GetWalletUTXO(ONLY_DENOMINATED).count(outDenom));
+    BOOST_CHECK(walletUTXO.AbandonTransaction(hashAbandon));
+    BOOST_CHECK(walletUTXO.GetWalletUTXO(ONLY_DENOMINATED).count(outDenom));
+    CheckAvailableCoins(walletUTXO);
+
+    // so does a conflicted spend, for the inputs the conflicting tx leaves alone
+    AddTx(walletUTXO, {outCollateral, outNonDenom2}, {CTxOut(7 * COIN, scriptOther)}, false);
+    BOOST_CHECK(!walletUTXO.GetWalletUTXO(ALL_COINS).count(outCollateral));
+    BOOST_CHECK(!walletUTXO.GetWalletUTXO(ALL_COINS).count(outNonDenom2));
+    CMutableTransaction txConflict;
+    txConflict.vin.push_back(CTxIn(outNonDenom2));
+    txConflict.vout.push_back(CTxOut(7 * COIN, scriptOther));
+    walletUTXO.SyncTransaction(txConflict, chainActive.Tip(), 0);
+    BOOST_CHECK(walletUTXO.GetWalletUTXO(ONLY_PRIVATESEND_COLLATERAL).count(outCollateral));
+    BOOST_CHECK(!walletUTXO.GetWalletUTXO(ALL_COINS).count(outNonDenom2));
+    CheckAvailableCoins(walletUTXO);
+
+    // an import can make more outputs ours
+    walletUTXO.AddKeyPubKey(keyOther, keyOther.GetPubKey());
+    BOOST_CHECK(!walletUTXO.GetWalletUTXO(ALL_COINS).count(COutPoint(hashFund, 5)));
+    walletUTXO.RebuildWalletUTXO();
+    BOOST_CHECK(walletUTXO.GetWalletUTXO(ALL_COINS).count(COutPoint(hashFund, 5)));
+    CheckAvailableCoins(walletUTXO);
+}
+
 BOOST_FIXTURE_TEST_CASE(rescan, TestChain100Setup)
 {
     LOCK(cs_main);
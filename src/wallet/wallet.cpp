@@ -536,6 +536,10 @@ bool CWallet::ChangeWalletPassphrase(const SecureString& strOldWalletPassphrase,
 
 void CWallet::SetBestChain(const CBlockLocator& loc)
 {
+    {
+        LOCK(cs_wallet);
+        FlushPrivateSendRounds();
+    }
     CWalletDB walletdb(strWalletFile);
     walletdb.WriteBestBlock(loc);
 }
@@ -604,6 +608,10 @@ std::set<uint256> CWallet::GetConflicts(const uint256& txid) const
 
 void CWallet::Flush(bool shutdown)
 {
+    {
+        LOCK(cs_wallet);
+        FlushPrivateSendRounds();
+    }
     bitdb.Flush(shutdown);
 }
 
@@ -729,7 +737,7 @@ bool CWallet::IsSpent(const uint256& hash, unsigned int n) const
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(std::make_pair(outpoint, wtxid));
-    setWalletUTXO.erase(outpoint);
+    EraseFromWalletUTXO(outpoint);
 
     std::pair<TxSpends::iterator, TxSpends::iterator> range;
     range = mapTxSpends.equal_range(outpoint);
@@ -737,6 +745,70 @@ void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 }
 
 
+void CWallet::AddToWalletUTXO(const COutPoint& outpoint, const CAmount& nValue)
+{
+    setWalletUTXO.insert(outpoint);
+    // same rules as in AvailableCoins
+    bool fCollateral = CPrivateSend::IsCollateralAmount(nValue);
+    if (CPrivateSend::IsDenominatedAmount(nValue)) {
+        mapWalletUTXOByType[ONLY_DENOMINATED].insert(outpoint);
+    } else if (!fCollateral) {
+        mapWalletUTXOByType[ONLY_NONDENOMINATED].insert(outpoint);
+    }
+    if (fCollateral) {
+        mapWalletUTXOByType[ONLY_PRIVATESEND_COLLATERAL].insert(outpoint);
+    }
+    if (nValue == Params().GetConsensus().nMasternodeCost*COIN) {
+        mapWalletUTXOByType[ONLY_1000].insert(outpoint);
+    }
+}
+
+void CWallet::EraseFromWalletUTXO(const COutPoint& outpoint)
+{
+    if (!setWalletUTXO.erase(outpoint)) return;
+    for (auto& pair : mapWalletUTXOByType) {
+        pair.second.erase(outpoint);
+    }
+}
+
+void CWallet::UpdateWalletUTXO(const COutPoint& outpoint)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
+    if (it == mapWallet.end() || outpoint.n >= it->second.tx->vout.size()) return;
+    const CTxOut& txout = it->second.tx->vout[outpoint.n];
+    if (IsMine(txout) && !IsSpent(outpoint.hash, outpoint.n)) {
+        AddToWalletUTXO(outpoint, txout.nValue);
+    }
+}
+
+void CWallet::RebuildWalletUTXO()
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    setWalletUTXO.clear();
+    mapWalletUTXOByType.clear();
+    for (const auto& pair : mapWallet) {
+        for (unsigned int i = 0; i < pair.second.tx->vout.size(); ++i) {
+            if (IsMine(pair.second.tx->vout[i]) && !IsSpent(pair.first, i)) {
+                AddToWalletUTXO(COutPoint(pair.first, i), pair.second.tx->vout[i].nValue);
+            }
+        }
+    }
+}
+
+const std::set<COutPoint>& CWallet::GetWalletUTXO(AvailableCoinsType nCoinType) const
+{
+    static const std::set<COutPoint> setEmpty;
+
+    if (nCoinType == ALL_COINS) return setWalletUTXO;
+    std::map<AvailableCoinsType, std::set<COutPoint> >::const_iterator it = mapWalletUTXOByType.find(nCoinType);
+    return it == mapWalletUTXOByType.end() ? setEmpty : it->second;
+}
+
 void CWallet::AddToSpends(const uint256& wtxid)
 {
     assert(mapWallet.count(wtxid));
@@ -1118,7 +1190,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         AddToSpends(hash);
         for(unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
             if (IsMine(wtx.tx->vout[i]) && !IsSpent(hash, i)) {
-                setWalletUTXO.insert(COutPoint(hash, i));
+                AddToWalletUTXO(COutPoint(hash, i), wtx.tx->vout[i].nValue);
             }
         }
     }
@@ -1158,6 +1230,19 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         if (!walletdb.WriteTx(wtx))
             return false;
 
+    if (fInsertedNew) {
+        // wallet txs spending this one could be added before it, e.g. during a rescan,
+        // their rounds were found without it
+        EraseDescendantPrivateSendRounds(hash);
+        // find the rounds of new denominated outputs while the ones of their inputs are cached
+        for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
+            if (IsMine(wtx.tx->vout[i]) && CPrivateSend::IsDenominatedAmount(wtx.tx->vout[i].nValue)) {
+                GetRealOutpointPrivateSendRounds(COutPoint(hash, i), 0);
+            }
+        }
+        FlushPrivateSendRounds();
+    }
+
     // Break debit/credit balance caches:
     wtx.MarkDirty();
 
@@ -1295,8 +1380,11 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             // available of the outputs it spends. So force those to be recomputed
             BOOST_FOREACH(const CTxIn& txin, wtx.tx->vin)
             {
-                if (mapWallet.count(txin.prevout.hash))
+                if (mapWallet.count(txin.prevout.hash)) {
                     mapWallet[txin.prevout.hash].MarkDirty();
+                    // the output may be spendable again
+                    UpdateWalletUTXO(txin.prevout);
+                }
             }
         }
     }
@@ -1359,8 +1447,11 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             // available of the outputs it spends. So force those to be recomputed
             BOOST_FOREACH(const CTxIn& txin, wtx.tx->vin)
             {
-                if (mapWallet.count(txin.prevout.hash))
+                if (mapWallet.count(txin.prevout.hash)) {
                     mapWallet[txin.prevout.hash].MarkDirty();
+                    // the output may be spendable again
+                    UpdateWalletUTXO(txin.prevout);
+                }
             }
         }
     }
@@ -1426,10 +1517,18 @@ CAmount CWallet::GetDebit(const CTxIn &txin, const isminefilter& filter) const
 // Recursively determine the rounds of a given input (How deep is the PrivateSend chain for a given input)
 int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds) const
 {
-    static std::map<uint256, CMutableTransaction> mDenomWtxes;
+    bool fTruncated = false;
+    return GetRealOutpointPrivateSendRounds(outpoint, nRounds, fTruncated);
+}
+
+// fTruncated is set if the result depends on a part of the ancestry which wasn't walked
+int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds, bool& fTruncated) const
+{
+    AssertLockHeld(cs_wallet);
 
     if(nRounds >= MAX_PRIVATESEND_ROUNDS) {
         // there can only be MAX_PRIVATESEND_ROUNDS rounds max
+        fTruncated = true;
         return MAX_PRIVATESEND_ROUNDS - 1;
     }
 
@@ -1439,17 +1538,15 @@ int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRo
     const CWalletTx* wtx = GetWalletTx(hash);
     if(wtx != NULL)
     {
-        std::map<uint256, CMutableTransaction>::const_iterator mdwi = mDenomWtxes.find(hash);
-        if (mdwi == mDenomWtxes.end()) {
-            // not known yet, let's add it
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds INSERTING %s\n", hash.ToString());
-            mDenomWtxes[hash] = CMutableTransaction(*wtx);
-        } else if(mDenomWtxes[hash].vout[nout].nRounds != -10) {
-            // found and it's not an initial value, just return it
-            return mDenomWtxes[hash].vout[nout].nRounds;
+        std::map<COutPoint, int>::const_iterator itRounds = mapOutpointRoundsCache.find(outpoint);
+        if (itRounds != mapOutpointRoundsCache.end()) {
+            // found, just return it
+            if (setOutpointRoundsTruncated.count(outpoint)) {
+                fTruncated = true;
+            }
+            return itRounds->second;
         }
 
-
         // bounds check
         if (nout >= wtx->tx->vout.size()) {
             // should never actually hit this
@@ -1458,16 +1555,16 @@ int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRo
         }
 
         if (CPrivateSend::IsCollateralAmount(wtx->tx->vout[nout].nValue)) {
-            mDenomWtxes[hash].vout[nout].nRounds = -3;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+            CacheOutpointPrivateSendRounds(outpoint, -3, false);
+            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, -3);
+            return -3;
         }
 
         //make sure the final output is non-denominate
         if (!CPrivateSend::IsDenominatedAmount(wtx->tx->vout[nout].nValue)) { //NOT DENOM
-            mDenomWtxes[hash].vout[nout].nRounds = -2;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+            CacheOutpointPrivateSendRounds(outpoint, -2, false);
+            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, -2);
+            return -2;
         }
 
         bool fAllDenoms = true;
@@ -1477,17 +1574,18 @@ int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRo
 
         // this one is denominated but there is another non-denominated output found in the same tx
         if (!fAllDenoms) {
-            mDenomWtxes[hash].vout[nout].nRounds = 0;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+            CacheOutpointPrivateSendRounds(outpoint, 0, false);
+            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, 0);
+            return 0;
         }
 
         int nShortest = -10; // an initial value, should be no way to get this by calculations
         bool fDenomFound = false;
+        bool fTruncatedInputs = false;
         // only denoms here so let's look up
         for (const auto& txinNext : wtx->tx->vin) {
             if (IsMine(txinNext)) {
-                int n = GetRealOutpointPrivateSendRounds(txinNext.prevout, nRounds + 1);
+                int n = GetRealOutpointPrivateSendRounds(txinNext.prevout, nRounds + 1, fTruncatedInputs);
                 // denom found, find the shortest chain or initially assign nShortest with the first found value
                 if(n >= 0 && (n < nShortest || nShortest == -10)) {
                     nShortest = n;
@@ -1495,16 +1593,114 @@ int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRo
                 }
             }
         }
-        mDenomWtxes[hash].vout[nout].nRounds = fDenomFound
+        int nRoundsRet = fDenomFound
                 ? (nShortest >= MAX_PRIVATESEND_ROUNDS - 1 ? MAX_PRIVATESEND_ROUNDS : nShortest + 1) // good, we a +1 to the shortest one but only MAX_PRIVATESEND_ROUNDS rounds max allowed
                 : 0;            // too bad, we are the fist one in that chain
-        LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-        return mDenomWtxes[hash].vout[nout].nRounds;
+        // this one took a walk through the ancestry, keep it on disk too unless the walk was cut off,
+        // the rounds of an outpoint found deep down in the ancestry of another one can be too high
+        if (fTruncatedInputs) {
+            setOutpointRoundsTruncated.insert(outpoint);
+            fTruncated = true;
+        }
+        CacheOutpointPrivateSendRounds(outpoint, nRoundsRet, !fTruncatedInputs);
+        LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, nRoundsRet);
+        return nRoundsRet;
     }
 
     return nRounds - 1;
 }
 
+void CWallet::CacheOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds, bool fWriteToDisk) const
+{
+    mapOutpointRoundsCache[outpoint] = nRounds;
+    if (fWriteToDisk && fFileBacked) {
+        // this can run for every output of a large wallet in a row, write them in batches
+        setOutpointRoundsUnsaved.insert(outpoint);
+        if (setOutpointRoundsUnsaved.size() >= PRIVATESEND_ROUNDS_WRITE_BATCH_SIZE) {
+            FlushPrivateSendRounds();
+        }
+    }
+}
+
+void CWallet::FlushPrivateSendRounds() const
+{
+    AssertLockHeld(cs_wallet);
+
+    if (setOutpointRoundsUnsaved.empty()) return;
+
+    // they are only a cache, the ones lost on a failure are found again
+    CWalletDB walletdb(strWalletFile, "r+", false);
+    walletdb.TxnBegin();
+    for (const auto& outpoint : setOutpointRoundsUnsaved) {
+        std::map<COutPoint, int>::const_iterator it = mapOutpointRoundsCache.find(outpoint);
+        if (it != mapOutpointRoundsCache.end()) {
+            walletdb.WritePrivateSendRounds(outpoint, it->second);
+        }
+    }
+    walletdb.TxnCommit();
+    setOutpointRoundsUnsaved.clear();
+}
+
+void CWallet::EraseDescendantPrivateSendRounds(const uint256& hash)
+{
+    AssertLockHeld(cs_wallet);
+
+    if (mapOutpointRoundsCache.empty()) return;
+
+    std::vector<COutPoint> vecErased;
+    std::vector<uint256> vecHashes(1, hash);
+    std::set<uint256> setSeen;
+    while (!vecHashes.empty()) {
+        uint256 hashTx = vecHashes.back();
+        vecHashes.pop_back();
+        const CWalletTx* wtx = GetWalletTx(hashTx);
+        if (wtx == NULL) continue;
+        for (unsigned int i = 0; i < wtx->tx->vout.size(); i++) {
+            COutPoint outpoint(hashTx, i);
+            if (mapOutpointRoundsCache.erase(outpoint)) {
+                // no need to go to disk for the ones which never made it there
+                if (!setOutpointRoundsUnsaved.erase(outpoint) && !setOutpointRoundsTruncated.erase(outpoint)) {
+                    vecErased.push_back(outpoint);
+                }
+            }
+            std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range = mapTxSpends.equal_range(outpoint);
+            for (TxSpends::const_iterator it = range.first; it != range.second; ++it) {
+                if (setSeen.insert(it->second).second) {
+                    vecHashes.push_back(it->second);
+                }
+            }
+        }
+    }
+
+    if (vecErased.empty() || !fFileBacked) return;
+
+    CWalletDB walletdb(strWalletFile, "r+", false);
+    walletdb.TxnBegin();
+    for (const auto& outpoint : vecErased) {
+        walletdb.ErasePrivateSendRounds(outpoint);
+    }
+    walletdb.TxnCommit();
+}
+
+void CWallet::ClearPrivateSendRounds()
+{
+    AssertLockHeld(cs_wallet);
+
+    if (fFileBacked && !mapOutpointRoundsCache.empty()) {
+        CWalletDB walletdb(strWalletFile);
+        walletdb.TxnBegin();
+        for (const auto& pair : mapOutpointRoundsCache) {
+            if (!setOutpointRoundsUnsaved.count(pair.first) && !setOutpointRoundsTruncated.count(pair.first)) {
+                walletdb.ErasePrivateSendRounds(pair.first);
+            }
+        }
+        walletdb.TxnCommit();
+    }
+    mapOutpointRoundsCache.clear();
+    setOutpointRoundsUnsaved.clear();
+    setOutpointRoundsTruncated.clear();
+}
+
 // respect current settings
 int CWallet::GetOutpointPrivateSendRounds(const COutPoint& outpoint) const
 {
@@ -2573,70 +2769,69 @@ void CWallet::AvailableCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed,
 
     {
         LOCK2(cs_main, cs_wallet);
-        int nInstantSendConfirmationsRequired = Params().GetConsensus().nInstantSendConfirmationsRequired;
 
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
-
-            if (!CheckFinalTx(*pcoin))
-                continue;
-
-            if (fOnlyConfirmed && !pcoin->IsTrusted())
-                continue;
-
-            if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
-                continue;
+        // Only look at our unspent outputs of the requested kind. They are ordered
+        // by tx hash, so the checks of a tx are done once for all its outputs.
+        const std::set<COutPoint>& setCoins = GetWalletUTXO(nCoinType);
+        const CWalletTx* pcoin = NULL;
+        bool fSkipTx = true;
+        int nDepth = 0;
+
+        for (const auto& outpoint : setCoins) {
+            const uint256& wtxid = outpoint.hash;
+            unsigned int i = outpoint.n;
+
+            if (pcoin == NULL || pcoin->GetHash() != wtxid) {
+                std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(wtxid);
+                if (it == mapWallet.end()) {
+                    pcoin = NULL;
+                    continue;
+                }
+                pcoin = &(*it).second;
+                fSkipTx = !IsAvailableCoinTx(*pcoin, fOnlyConfirmed, fUseInstantSend, nDepth);
+            }
+            if (fSkipTx) continue;
+            if (i >= pcoin->tx->vout.size()) continue;
+
+            isminetype mine = IsMine(pcoin->tx->vout[i]);
+            if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
+                (!IsLockedCoin(wtxid, i) || nCoinType == ONLY_1000) &&
+                (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
+                (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(outpoint))) {
+                    vCoins.push_back(COutput(pcoin, i, nDepth,
+                                             ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
+                                              (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
+                                             (mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
+            }
+        }
+    }
+}
 
-            int nDepth = pcoin->GetDepthInMainChain(false);
-            // do not use IX for inputs that have less then nInstantSendConfirmationsRequired blockchain confirmations
-            if (fUseInstantSend && nDepth < nInstantSendConfirmationsRequired)
-                continue;
+bool CWallet::IsAvailableCoinTx(const CWalletTx& wtx, bool fOnlyConfirmed, bool fUseInstantSend, int& nDepthRet) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
 
-            // We should not consider coins which aren't at least in our mempool
-            // It's possible for these to be conflicted via ancestors which we may never be able to detect
-            if (nDepth == 0 && !pcoin->InMempool())
-                continue;
+    if (!CheckFinalTx(wtx))
+        return false;
 
-            // We should not consider coins which aren't at least in our mempool
-            // It's possible for these to be conflicted via ancestors which we may never be able to detect
-            if (nDepth == 0 && !pcoin->InMempool())
-                continue;
+    if (fOnlyConfirmed && !wtx.IsTrusted())
+        return false;
 
-            for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
-                bool found = false;
-                if(nCoinType == ONLY_DENOMINATED) {
-                    found = CPrivateSend::IsDenominatedAmount(pcoin->tx->vout[i].nValue);
-                } else if(nCoinType == ONLY_NONDENOMINATED) {
-                    if (CPrivateSend::IsCollateralAmount(pcoin->tx->vout[i].nValue)) continue; // do not use collateral amounts
-                    found = !CPrivateSend::IsDenominatedAmount(pcoin->tx->vout[i].nValue);
-                } else if(nCoinType == ONLY_1000) { //     ONLY_1000, // find masternode outputs including locked ones (use with caution)
-                    found = pcoin->tx->vout[i].nValue == Params().GetConsensus().nMasternodeCost*COIN; //!!!
-                    //LogPrintf("found %d\n", found);
-                } else if(nCoinType == ONLY_PRIVATESEND_COLLATERAL) {
-                    found = CPrivateSend::IsCollateralAmount(pcoin->tx->vout[i].nValue);
-                } else {
-                    found = true;
-                }
-                if(!found) continue;
+    if (wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0)
+        return false;
 
-                isminetype mine = IsMine(pcoin->tx->vout[i]);
-                if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    (!IsLockedCoin((*it).first, i) || nCoinType == ONLY_1000) &&
-                    (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint((*it).first, i)))){ 
-                    //LogPrintf("DEBUG: Not-spent %d, mine %d, locked or collateral %d, %d higher than 0, %d coincontrol shit", !(IsSpent(wtxid, i)), mine != ISMINE_NO, (!IsLockedCoin((*it).first, i) || nCoinType == ONLY_1000), (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue), (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint((*it).first, i))));    
+    nDepthRet = wtx.GetDepthInMainChain(false);
+    // do not use IX for inputs that have less then nInstantSendConfirmationsRequired blockchain confirmations
+    if (fUseInstantSend && nDepthRet < Params().GetConsensus().nInstantSendConfirmationsRequired)
+        return false;
 
-                        vCoins.push_back(COutput(pcoin, i, nDepth,
-                                                 ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
-                                                  (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
-                                                 (mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO));
-                }   
+    // We should not consider coins which aren't at least in our mempool
+    // It's possible for these to be conflicted via ancestors which we may never be able to detect
+    if (nDepthRet == 0 && !wtx.InMempool())
+        return false;
 
-            }
-        }
-    }
+    return true;
 }
 
 static void ApproximateBestSubset(std::vector<std::pair<CAmount, std::pair<const CWalletTx*,unsigned int> > >vValue, const CAmount& nTotalLower, const CAmount& nTargetValue,
@@ -3961,13 +4156,7 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (auto& pair : mapWallet) {
-            for(unsigned int i = 0; i < pair.second.tx->vout.size(); ++i) {
-                if (IsMine(pair.second.tx->vout[i]) && !IsSpent(pair.first, i)) {
-                    setWalletUTXO.insert(COutPoint(pair.first, i));
-                }
-            }
-        }
+        RebuildWalletUTXO();
     }
 
     if (nLoadWalletRet != DB_LOAD_OK)
@@ -4000,6 +4189,12 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
     if (nZapSelectTxRet != DB_LOAD_OK)
         return nZapSelectTxRet;
 
+    {
+        LOCK2(cs_main, cs_wallet);
+        // the outputs of the removed txs are gone, and the ones they spent are unspent again
+        RebuildWalletUTXO();
+    }
+
     MarkDirty();
 
     return DB_LOAD_OK;
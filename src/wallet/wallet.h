@@ -71,6 +71,8 @@ static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 6;
 static const unsigned int MAX_FREE_TRANSACTION_CREATE_SIZE = 1000;
 static const bool DEFAULT_WALLETBROADCAST = true;
 static const bool DEFAULT_DISABLE_WALLET = false;
+//! Number of new PrivateSend rounds which are written to the wallet database in one transaction
+static const unsigned int PRIVATESEND_ROUNDS_WRITE_BATCH_SIZE = 1000;
 
 extern const char * DEFAULT_WALLET_DAT;
 
@@ -655,6 +657,22 @@ private:
     mutable bool fAnonymizableTallyCachedNonDenom;
     mutable std::vector<CompactTallyItem> vecAnonymizableTallyCachedNonDenom;
 
+    /**
+     * PrivateSend rounds of our outpoints. Rounds found by walking the input
+     * ancestry are also kept in the wallet database, so the walk is only done
+     * once per outpoint and not again after a restart. New ones are written
+     * in batches, the ones not written yet are kept in setOutpointRoundsUnsaved.
+     * Rounds that depend on a walk cut off at MAX_PRIVATESEND_ROUNDS deep are
+     * only kept in memory, they are listed in setOutpointRoundsTruncated.
+     */
+    mutable std::map<COutPoint, int> mapOutpointRoundsCache;
+    mutable std::set<COutPoint> setOutpointRoundsUnsaved;
+    mutable std::set<COutPoint> setOutpointRoundsTruncated;
+    int GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds, bool& fTruncated) const;
+    void CacheOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds, bool fWriteToDisk) const;
+    void FlushPrivateSendRounds() const;
+    void EraseDescendantPrivateSendRounds(const uint256& hash);
+
     /**
      * Used to keep track of spent outpoints, and
      * detect and report conflicts (double-spends or
@@ -665,7 +683,21 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /**
+     * Our unspent outputs, so that coin selection and balances scale with the
+     * unspent outputs rather than with the whole history. Also split by the
+     * kinds of coins AvailableCoins can be asked for. Outputs spent by txs which
+     * were abandoned or conflicted later on are put back, so this is a superset
+     * of what IsSpent() considers unspent and users still have to check it.
+     */
     std::set<COutPoint> setWalletUTXO;
+    std::map<AvailableCoinsType, std::set<COutPoint> > mapWalletUTXOByType;
+    void AddToWalletUTXO(const COutPoint& outpoint, const CAmount& nValue);
+    void EraseFromWalletUTXO(const COutPoint& outpoint);
+    /// Put an output back if it's ours and not spent anymore
+    void UpdateWalletUTXO(const COutPoint& outpoint);
+    /// Tx level checks of AvailableCoins, sets the depth of a tx which passes them
+    bool IsAvailableCoinTx(const CWalletTx& wtx, bool fOnlyConfirmed, bool fUseInstantSend, int& nDepthRet) const;
 
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
@@ -764,6 +796,9 @@ public:
         fAnonymizableTallyCachedNonDenom = false;
         vecAnonymizableTallyCached.clear();
         vecAnonymizableTallyCachedNonDenom.clear();
+        mapOutpointRoundsCache.clear();
+        setOutpointRoundsUnsaved.clear();
+        setOutpointRoundsTruncated.clear();
     }
 
     std::map<uint256, CWalletTx> mapWallet;
@@ -826,6 +861,20 @@ public:
 
     bool IsDenominated(const COutPoint& outpoint) const;
 
+    //! Forget all PrivateSend rounds, imported keys and scripts can make more inputs ours
+    void ClearPrivateSendRounds();
+
+    //! Find our unspent outputs again, imported keys and scripts can make more outputs ours
+    void RebuildWalletUTXO();
+    //! Our unspent outputs of a kind, possibly including some which are spent already
+    const std::set<COutPoint>& GetWalletUTXO(AvailableCoinsType nCoinType) const;
+
+    //! Adds the PrivateSend rounds of an outpoint to the cache, without saving it to disk
+    void LoadPrivateSendRounds(const COutPoint& outpoint, int nRounds)
+    {
+        mapOutpointRoundsCache[outpoint] = nRounds;
+    }
+
     bool IsSpent(const uint256& hash, unsigned int n) const;
 
     bool IsLockedCoin(uint256 hash, unsigned int n) const;
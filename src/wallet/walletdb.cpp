@@ -526,6 +526,14 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
                 return false;
             }
         }
+        else if (strType == "psrounds")
+        {
+            COutPoint outpoint;
+            ssKey >> outpoint;
+            int nRounds;
+            ssValue >> nRounds;
+            pwallet->LoadPrivateSendRounds(outpoint, nRounds);
+        }
         else if (strType == "hdchain")
         {
             CHDChain chain;
@@ -976,6 +984,23 @@ bool CWalletDB::EraseDestData(const std::string &address, const std::string &key
     return Erase(std::make_pair(std::string("destdata"), std::make_pair(address, key)));
 }
 
+bool CWalletDB::ReadPrivateSendRounds(const COutPoint& outpoint, int& nRounds)
+{
+    return Read(std::make_pair(std::string("psrounds"), outpoint), nRounds);
+}
+
+bool CWalletDB::WritePrivateSendRounds(const COutPoint& outpoint, int nRounds)
+{
+    nWalletDBUpdateCounter++;
+    return Write(std::make_pair(std::string("psrounds"), outpoint), nRounds);
+}
+
+bool CWalletDB::ErasePrivateSendRounds(const COutPoint& outpoint)
+{
+    nWalletDBUpdateCounter++;
+    return Erase(std::make_pair(std::string("psrounds"), outpoint));
+}
+
 bool CWalletDB::WriteHDChain(const CHDChain& chain)
 {
     nWalletDBUpdateCounter++;
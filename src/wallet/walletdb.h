@@ -24,6 +24,7 @@ class CAccountingEntry;
 struct CBlockLocator;
 class CKeyPool;
 class CMasterKey;
+class COutPoint;
 class CScript;
 class CWallet;
 class CWalletTx;
@@ -124,6 +125,13 @@ public:
     /// Erase destination data tuple from wallet database
     bool EraseDestData(const std::string &address, const std::string &key);
 
+    /// Read the PrivateSend rounds of an outpoint from database
+    bool ReadPrivateSendRounds(const COutPoint& outpoint, int& nRounds);
+    /// Write the PrivateSend rounds of an outpoint to database
+    bool WritePrivateSendRounds(const COutPoint& outpoint, int nRounds);
+    /// Erase the PrivateSend rounds of an outpoint from database
+    bool ErasePrivateSendRounds(const COutPoint& outpoint);
+
     CAmount GetAccountCreditDebit(const std::string& strAccount);
     void ListAccountCreditDebit(const std::string& strAccount, std::list<CAccountingEntry>& acentries);
 